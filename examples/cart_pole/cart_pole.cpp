@@ -1,15 +1,35 @@
 #include <cart_pole/cart_pole.hpp>
+#include <core/policy_controller.hpp>
+
+#include <iostream>
+#include <memory>
 
 CartPole::CartPole() : Application("CartPole", "cart_pole.xml") {
     m_JointHingeId = mj_name2id(&model(), mjOBJ_JOINT, JOINT_HINGE_NAME);
     m_JointSlideId = mj_name2id(&model(), mjOBJ_JOINT, JOINT_SLIDE_NAME);
     m_ActuatorSlideId = mj_name2id(&model(), mjOBJ_ACTUATOR, ACTUATOR_NAME);
+    // Show the model's cameras next to the free camera (right column)
+    AddViewport(CAMERA_FIXED_NAME, VIEW_LEFT, VIEW_SIZE, VIEW_SIZE, VIEW_SIZE);
+    AddViewport(CAMERA_LOOKAT_NAME, VIEW_LEFT, 0.0F, VIEW_SIZE, VIEW_SIZE);
 }
 
 auto CartPole::_SimStepInternal() -> void {
     data().ctrl[m_ActuatorSlideId] = m_CartForceX;  // NOLINT
 }
 
+auto CartPole::SetCartController(std::shared_ptr<Controller> controller)
+    -> void {
+    m_CartController = std::move(controller);
+    SetController(m_CartController);
+}
+
+auto CartPole::_ReloadInternal() -> void {
+    // Reloading releases the controller, as the model's layout might change
+    if (m_CartController != nullptr) {
+        SetController(m_CartController);
+    }
+}
+
 auto CartPole::GetTheta() const -> double {
     return data().qpos[m_JointHingeId];  // NOLINT
 }
@@ -18,10 +38,22 @@ auto CartPole::GetPositionX() const -> mjtNum {
     return data().qpos[m_JointSlideId];  // NOLINT
 }
 
-auto main() -> int {
+auto main(int argc, char** argv) -> int {
     CartPole sim;
     sim.Initialize();
 
+    // Optionally, drive the cart using a trained policy given as argument
+    if (argc > 1) {
+        auto policy = std::make_shared<MlpPolicy>();
+        if (policy->Load(argv[1])) {  // NOLINT
+            std::cout << "CartPole >> using policy [" << argv[1]  // NOLINT
+                      << "] (" << MlpPolicy::GetSimdBackend() << ")"
+                      << std::endl;
+            sim.SetCartController(
+                std::make_shared<PolicyController>(std::move(policy)));
+        }
+    }
+
     while (sim.IsActive()) {
         sim.Step();
         sim.Render();
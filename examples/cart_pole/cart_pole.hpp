@@ -2,9 +2,18 @@
 
 #include <core/application.hpp>
 
+#include <memory>
+
 static constexpr const char* JOINT_HINGE_NAME = "hinge_1";
 static constexpr const char* JOINT_SLIDE_NAME = "slider";
 static constexpr const char* ACTUATOR_NAME = "force";
+static constexpr const char* CAMERA_FIXED_NAME = "fixed";
+static constexpr const char* CAMERA_LOOKAT_NAME = "lookatcart";
+
+/// Size of the additional views (as a fraction of the window)
+static constexpr float VIEW_SIZE = 0.3F;
+/// Left border of the additional views (as a fraction of the window)
+static constexpr float VIEW_LEFT = 1.0F - VIEW_SIZE;
 
 class CartPole : public Application {
  public:
@@ -19,9 +28,14 @@ class CartPole : public Application {
     /// Sets the force applied to the cart
     auto SetForceX(mjtNum force) -> void { m_CartForceX = force; }
 
+    /// Drives the cart with the given controller (kept across reloads)
+    auto SetCartController(std::shared_ptr<Controller> controller) -> void;
+
  protected:
     auto _SimStepInternal() -> void override;
 
+    auto _ReloadInternal() -> void override;
+
  private:
     /// The id of the hinge joint connecting the cart to the pole
     int m_JointHingeId{-1};
@@ -31,4 +45,6 @@ class CartPole : public Application {
     int m_ActuatorSlideId{-1};
     /// Amount of force applied at the cart
     mjtNum m_CartForceX{0.0};
+    /// Controller driving the cart (nullptr if driven by SetForceX)
+    std::shared_ptr<Controller> m_CartController{nullptr};
 };
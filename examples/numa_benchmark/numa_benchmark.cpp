@@ -0,0 +1,117 @@
+#include <core/model_library.hpp>
+#include <core/numa_stepper.hpp>
+#include <core/numa_topology.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// Default number of environments per worker thread
+static constexpr int ENVS_PER_THREAD = 32;
+/// Default number of timed control steps per environment
+static constexpr int NUM_STEPS = 500;
+/// Number of untimed control steps run first (warms caches and page tables)
+static constexpr int NUM_WARMUP_STEPS = 50;
+/// Number of times each configuration is timed (the best run is kept)
+static constexpr int NUM_REPEATS = 3;
+
+/// Prints how to use this example
+auto PrintUsage(const char* program) -> void {
+    std::cout << "usage: " << program
+              << " [num_threads] [envs_per_thread] [num_steps]\n"
+              << "  steps every model of the resources folder with unpinned "
+                 "workers sharing a\n"
+              << "  single model, and then with NUMA-aware pinned workers, "
+                 "and compares them"
+              << std::endl;
+}
+
+/// Returns the best throughput (env-steps per second) of the given settings
+auto Measure(const mjModel& model, int num_envs, int num_steps,
+             const NumaStepperSettings& settings, const NumaTopology& topology)
+    -> double {
+    NumaStepper stepper(model, num_envs, settings, topology);
+    double best = 0.0;
+    for (int r = 0; r < NUM_REPEATS; ++r) {
+        stepper.Reset();
+        stepper.Step(NUM_WARMUP_STEPS);
+        const auto start = std::chrono::steady_clock::now();
+        stepper.Step(num_steps);
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::max(best, static_cast<double>(num_envs) * num_steps /
+                                  elapsed.count());
+    }
+    return best;
+}
+
+auto main(int argc, char** argv) -> int {
+    // NOLINTNEXTLINE
+    const std::vector<std::string> args(argv + 1, argv + argc);
+    if (!args.empty() && (args[0] == "-h" || args[0] == "--help")) {
+        PrintUsage(argv[0]);  // NOLINT
+        return 0;
+    }
+
+    const auto topology = NumaTopology::Detect();
+    const int num_threads = args.empty() ? topology.GetNumCpus()
+                                         : std::atoi(args[0].c_str());
+    const int envs_per_thread =
+        args.size() > 1 ? std::atoi(args[1].c_str()) : ENVS_PER_THREAD;
+    const int num_steps =
+        args.size() > 2 ? std::atoi(args[2].c_str()) : NUM_STEPS;
+    if (num_threads <= 0 || envs_per_thread <= 0 || num_steps <= 0) {
+        PrintUsage(argv[0]);  // NOLINT
+        return 1;
+    }
+    const int num_envs = num_threads * envs_per_thread;
+
+    // Baseline: threads float freely, share the original model, and all
+    // simulations are allocated by the main thread (i.e. on its node)
+    NumaStepperSettings unpinned;
+    unpinned.num_threads = num_threads;
+    unpinned.pin_threads = false;
+    unpinned.replicate_model = false;
+    unpinned.local_data = false;
+
+    NumaStepperSettings pinned;
+    pinned.num_threads = num_threads;
+
+    std::cout << "NumaBenchmark >> " << topology.ToString() << "\n"
+              << "NumaBenchmark >> " << num_threads << " threads, "
+              << num_envs << " envs, " << num_steps << " steps" << std::endl;
+
+    ModelLibrary library(0, 0);
+    library.AddDirectory(MUJOCOEXT_RESOURCES_PATH);
+    library.WaitAll();
+
+    constexpr int NAME_WIDTH = 20;
+    constexpr int COLUMN_WIDTH = 14;
+    std::cout << std::left << std::setw(NAME_WIDTH) << "model" << std::right
+              << std::setw(COLUMN_WIDTH) << "unpinned"
+              << std::setw(COLUMN_WIDTH) << "pinned" << std::setw(COLUMN_WIDTH)
+              << "speedup" << std::endl;
+    for (int id = 0; id < library.GetNumModels(); ++id) {
+        const auto model = library.GetModel(id);
+        if (model == nullptr) {
+            continue;
+        }
+        const double baseline =
+            Measure(*model, num_envs, num_steps, unpinned, topology);
+        const double numa =
+            Measure(*model, num_envs, num_steps, pinned, topology);
+        std::cout << std::left << std::setw(NAME_WIDTH) << library.GetName(id)
+                  << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(COLUMN_WIDTH) << baseline
+                  << std::setw(COLUMN_WIDTH) << numa << std::setprecision(2)
+                  << std::setw(COLUMN_WIDTH - 1) << numa / baseline << "x"
+                  << std::endl;
+    }
+    std::cout << "NumaBenchmark >> throughput in env-steps/s (best of "
+              << NUM_REPEATS << " runs)" << std::endl;
+    return 0;
+}
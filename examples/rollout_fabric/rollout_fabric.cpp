@@ -0,0 +1,161 @@
+#include <core/deleters.hpp>
+#include <core/determinism_checker.hpp>
+#include <core/rollout_coordinator.hpp>
+#include <core/rollout_worker.hpp>
+
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Default address the coordinator listens at
+static constexpr const char* DEFAULT_ADDRESS = "/tmp/mujocoext_rollout.sock";
+/// Default model simulated by the workers
+static constexpr const char* DEFAULT_MODEL = "cart_pole.xml";
+/// Number of environments simulated per run
+static constexpr uint32_t NUM_ENVS = 1024;
+/// Number of environments per chunk
+static constexpr uint32_t CHUNK_SIZE = 16;
+/// Number of control steps per environment
+static constexpr uint32_t NUM_STEPS = 500;
+/// Amplitude of the noise added to the initial joint positions
+static constexpr double JITTER_SCALE = 0.05;
+/// Seconds to wait for the local workers to connect
+static constexpr double CONNECT_TIMEOUT = 10.0;
+/// Delay before killing a worker when testing fault tolerance
+static constexpr auto KILL_DELAY = std::chrono::milliseconds(200);
+
+/// Prints how to use this example
+auto PrintUsage(const char* program) -> void {
+    std::cout << "usage:\n"
+              << "  " << program
+              << " [num_workers] [model] [address] [--kill-one]\n"
+              << "      forks num_workers local workers and runs a batch\n"
+              << "  " << program << " worker <address> [model]\n"
+              << "      runs a single worker (e.g. on another machine, using "
+                 "tcp://host:port)"
+              << std::endl;
+}
+
+/// Resolves a model name relative to the resources folder
+auto ResolveModelPath(const std::string& model) -> std::string {
+    if (model.find('/') != std::string::npos) {
+        return model;
+    }
+    return std::string(MUJOCOEXT_RESOURCES_PATH) + model;
+}
+
+auto main(int argc, char** argv) -> int {
+    // NOLINTNEXTLINE
+    const std::vector<std::string> args(argv + 1, argv + argc);
+
+    RolloutWorkerSettings worker_settings;
+    worker_settings.jitter_scale = JITTER_SCALE;
+
+    if (!args.empty() && args[0] == "worker") {
+        if (args.size() < 2) {
+            PrintUsage(argv[0]);  // NOLINT
+            return 1;
+        }
+        RolloutWorker worker(
+            ResolveModelPath(args.size() > 2 ? args[2] : DEFAULT_MODEL),
+            worker_settings);
+        const int num_chunks = worker.Run(args[1]);
+        std::cout << "RolloutFabric >> worker done after " << num_chunks
+                  << " chunks" << std::endl;
+        return num_chunks < 0 ? 1 : 0;
+    }
+
+    bool kill_one = false;
+    std::vector<std::string> positional;
+    for (const auto& arg : args) {
+        if (arg == "--kill-one") {
+            kill_one = true;
+        } else if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);  // NOLINT
+            return 0;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    const auto num_cores = std::max(1U, std::thread::hardware_concurrency());
+    const int num_workers = positional.empty()
+                                ? static_cast<int>(num_cores)
+                                : std::atoi(positional[0].c_str());
+    const auto model_path =
+        ResolveModelPath(positional.size() > 1 ? positional[1] : DEFAULT_MODEL);
+    const std::string address =
+        positional.size() > 2 ? positional[2] : DEFAULT_ADDRESS;
+
+    // Compile the model once; the forked workers share it copy-on-write
+    std::array<char, 1024> error_buffer{};  // NOLINT
+    std::unique_ptr<mjModel, MjcModelDeleter> model(
+        mj_loadXML(model_path.c_str(), nullptr, error_buffer.data(),
+                   static_cast<int>(error_buffer.size())));
+    if (!model) {
+        std::cout << "RolloutFabric >> couldn't load model [" << model_path
+                  << "]: " << error_buffer.data() << std::endl;
+        return 1;
+    }
+
+    RolloutCoordinator coordinator;
+    if (!coordinator.Listen(address)) {
+        return 1;
+    }
+    auto pids = RolloutWorker::SpawnLocal(num_workers, *model, address,
+                                          worker_settings);
+    coordinator.WaitForWorkers(pids.size(), CONNECT_TIMEOUT);
+    std::cout << "RolloutFabric >> " << coordinator.GetNumWorkers()
+              << " workers connected to [" << address << "]" << std::endl;
+
+    // Optionally, kill one worker halfway to check the batch still completes
+    std::thread killer;
+    if (kill_one && !pids.empty()) {
+        killer = std::thread([pid = pids.front()]() {
+            std::this_thread::sleep_for(KILL_DELAY);
+            kill(pid, SIGKILL);
+        });
+    }
+
+    const auto chunks =
+        RolloutCoordinator::MakeChunks(NUM_ENVS, CHUNK_SIZE, NUM_STEPS);
+    const bool success = coordinator.Run(chunks);
+    if (killer.joinable()) {
+        killer.join();
+    }
+
+    const auto& stats = coordinator.GetStats();
+    const double env_steps = static_cast<double>(NUM_ENVS) * NUM_STEPS;
+    std::cout << "RolloutFabric >> " << (success ? "completed" : "failed")
+              << " " << chunks.size() << " chunks in " << stats.duration
+              << "s (" << env_steps / stats.duration << " env-steps/s)\n"
+              << "  dispatched: " << stats.num_dispatched
+              << ", stolen: " << stats.num_stolen
+              << ", speculative: " << stats.num_speculative
+              << ", reissued: " << stats.num_reissued
+              << ", duplicates: " << stats.num_duplicates
+              << ", lost workers: " << stats.num_lost_workers << std::endl;
+
+    // Combine the per-environment hashes into a single digest of the batch
+    uint32_t digest = 0;
+    for (const auto& result : coordinator.GetResults()) {
+        digest = HashBuffer(result.data(), result.size(), digest);
+    }
+    std::cout << "RolloutFabric >> digest of final states: " << std::hex
+              << digest << std::dec << std::endl;
+
+    coordinator.Shutdown();
+    for (const auto pid : pids) {
+        waitpid(pid, nullptr, 0);
+    }
+    return success ? 0 : 1;
+}
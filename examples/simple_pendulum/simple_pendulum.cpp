@@ -2,6 +2,8 @@
 
 #include <simple_pendulum/simple_pendulum.hpp>
 
+#include <memory>
+
 /// The torque applied to the joint of the pendulum
 static float s_torque = 0.0F;  // NOLINT
 
@@ -49,6 +51,18 @@ SimplePendulum::SimplePendulum()
     s_settings.ixx = model().body_inertia[3 * m_BodyPoleId + 0];  // NOLINT
     s_settings.iyy = model().body_inertia[3 * m_BodyPoleId + 1];  // NOLINT
     s_settings.izz = model().body_inertia[3 * m_BodyPoleId + 2];  // NOLINT
+    // Keep a history of the sensors, the applied torque and the solver
+    auto telemetry = std::make_shared<Telemetry>();
+    _AddTelemetryChannels(*telemetry);
+    SetTelemetry(std::move(telemetry));
+}
+
+auto SimplePendulum::_AddTelemetryChannels(Telemetry& telemetry) -> void {
+    telemetry.AddSensor(model(), m_SensorJntPos.id);
+    telemetry.AddSensor(model(), m_SensorJntVel.id);
+    telemetry.AddChannel(model(),
+                         {"torque", TelemetrySource::CTRL, m_ActuatorHingeId});
+    telemetry.AddSolverStats();
 }
 
 auto SimplePendulum::_RenderUiInternal() -> void {
@@ -106,6 +120,10 @@ auto SimplePendulum::_ReloadInternal() -> void {
     s_settings.ixx = model().body_inertia[3 * m_BodyPoleId + 0];  // NOLINT
     s_settings.iyy = model().body_inertia[3 * m_BodyPoleId + 1];  // NOLINT
     s_settings.izz = model().body_inertia[3 * m_BodyPoleId + 2];  // NOLINT
+    // The channels of the previous model were cleared by the reload
+    if (GetTelemetry() != nullptr) {
+        _AddTelemetryChannels(*GetTelemetry());
+    }
 }
 
 auto SimplePendulum::GetTheta() const -> double {
@@ -35,6 +35,10 @@ class SimplePendulum : public Application {
 
     auto _ReloadInternal() -> void override;
 
+ private:
+    /// Adds the channels recorded by this example to the given telemetry
+    auto _AddTelemetryChannels(Telemetry& telemetry) -> void;
+
  private:
     int m_BodyPoleId{-1};
     int m_JointHingeId{-1};
@@ -1,11 +1,19 @@
 #include <tutorial_01/tutorial_01.hpp>
 
+#include <memory>
+
 Tutorial01::Tutorial01() : Application("Primitives", "tutorial_01.xml") {}
 
 auto main() -> int {
     Tutorial01 sim;
     sim.Initialize();
 
+    // Compile all the models in the resources folder in the background, so
+    // they can be picked from the "Model" dropdown without any loading stall
+    auto library = std::make_shared<ModelLibrary>();
+    library->AddDirectory(RESOURCES_PATH);
+    sim.SetModelLibrary(library);
+
     while (sim.IsActive()) {
         sim.Step();
         sim.Render();
@@ -6,42 +6,24 @@
 
 #include <mujoco/mujoco.h>
 
+#include <core/controller.hpp>
+#include <core/deleters.hpp>
+#include <core/determinism_checker.hpp>
+#include <core/model_library.hpp>
+#include <core/reset_cache.hpp>
+#include <core/scene_visibility.hpp>
+#include <core/telemetry.hpp>
+#include <core/viewer_control.hpp>
+
 #include <array>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
-
-/// Deleter for mjModel (when using unique_ptr)
-struct MjcModelDeleter {
-    auto operator()(mjModel* ptr) const -> void;
-};
-
-/// Deleter for mjData (when using unique_ptr)
-struct MjcDataDeleter {
-    auto operator()(mjData* ptr) const -> void;
-};
-
-/// Deleter for mjvScene (when using unique_ptr)
-struct MjvSceneDeleter {
-    auto operator()(mjvScene* ptr) const -> void;
-};
-
-#ifndef MUJOCOEXT_BUILD_HEADLESS
-/// Deleter for mjrContext (when using unique_ptr)
-struct MjrContextDeleter {
-    auto operator()(mjrContext* ptr) const -> void;
-};
-
-/// Deleter for GLFWwindow (when using unique_ptr)
-struct GLFWwindowDeleter {
-    auto operator()(GLFWwindow* ptr) const -> void;
-};
-#endif
+#include <vector>
 
 /// Size of the error buffer used to store logging messages
 static constexpr int ERROR_BUFFER_SIZE = 100;
-/// Maximum number of geometries available for the simulation
-static constexpr int NUM_MAX_GEOMETRIES = 2000;
 /// Target FPS of the simulation
 static constexpr mjtNum SIMULATION_FPS = static_cast<mjtNum>(60.0);
 
@@ -76,14 +58,41 @@ struct ApplicationState {
     bool dirty_reset = false;
     /// Whether or not a reload has been requested
     bool dirty_reload = false;
+    /// Whether or not detaching the viewer has been requested
+    bool dirty_detach = false;
+    /// Id (in the model library) of the model requested from the UI (-1 if
+    /// no switch has been requested)
+    int requested_model = -1;
     /// Whether the ui-framework ants to capture the mouse input
     bool wants_to_capture_mouse = false;
 };
 
+/// Additional view of the simulation, rendered from one of the model's cameras
+/// into a region of the window (in normalized window coordinates)
+struct Viewport {
+    /// Name of the camera (in the model) used by this view
+    std::string camera_name;
+    /// Camera used to render this view (fixed to the model's camera)
+    mjvCamera camera{};
+    /// Left border of the view (in [0, 1], from the left of the window)
+    float left = 0.0F;
+    /// Bottom border of the view (in [0, 1], from the bottom of the window)
+    float bottom = 0.0F;
+    /// Width of the view (as a fraction of the window's width)
+    float width = 1.0F;
+    /// Height of the view (as a fraction of the window's height)
+    float height = 1.0F;
+    /// Whether or not this view should be rendered
+    bool enabled = true;
+};
+
 class Application {
  public:
-    /// Creates an application object
-    explicit Application(const char* app_name, const char* app_model);
+    /// Creates an application object. If attach_viewer is false, the
+    /// simulation starts headless (no window, GL context nor UI), and a viewer
+    /// can be attached later on (see AttachViewer and EnableViewerControl)
+    explicit Application(const char* app_name, const char* app_model,
+                         bool attach_viewer = true);
 
     /// Destroys the resources allocated by this application
     virtual ~Application();
@@ -106,20 +115,75 @@ class Application {
     /// Advances the simulation by a single step
     auto Step() -> void;
 
-    /// Update the rendered scene and visualizer
+    /// Update the rendered scene and visualizer. Also handles the requests to
+    /// attach|detach the viewer, and does nothing else while detached
     auto Render() -> void;
 
+    /// Creates the window, the rendering context and the UI (if not created
+    /// yet). Returns whether or not the viewer is attached
+    auto AttachViewer() -> bool;
+
+    /// Releases the window, the rendering context and the UI (if any)
+    auto DetachViewer() -> void;
+
+    /// Enables requests to attach|detach the viewer through signals (SIGUSR1,
+    /// SIGUSR2), and through a unix socket if a path is given. Signals are
+    /// process-wide, so only one application per process should enable it
+    auto EnableViewerControl(const char* socket_path = nullptr) -> bool;
+
     /// Resets the current simulation to its initial configuration
     auto Reset() -> void;
 
-    /// Loads the model and creates simulation resources
+    /// Adds a view rendered from the model's camera with the given name into
+    /// the given region of the window (normalized coordinates). Returns the
+    /// index of the view, or -1 if the camera doesn't exist
+    auto AddViewport(const char* camera_name, float left, float bottom,
+                     float width, float height) -> int;
+
+    /// Returns the additional views rendered on top of the main one
+    auto GetViewports() -> std::vector<Viewport>& { return m_Viewports; }
+
+    /// Sets the number of scene geoms reserved on top of the model's estimate
+    /// (recreates the scene). The budget also grows if the scene gets full
+    auto SetSceneBudget(int budget) -> void;
+
+    /// Returns the number of scene geoms reserved on top of the model's
+    auto GetSceneBudget() const -> int { return m_SceneBudget; }
+
+    /// Returns the visibility layer applied to the scene before rendering
+    auto visibility() -> SceneVisibility& { return m_Visibility; }
+
+    /// Returns the visibility layer applied to the scene (read-only)
+    auto visibility() const -> const SceneVisibility& { return m_Visibility; }
+
+    /// Loads the model and creates simulation resources. As with SwitchModel,
+    /// the telemetry channels, determinism stream and controller are
+    /// cleared|released (bind new ones from _ReloadInternal)
     auto LoadModel() -> void;
 
+    /// Sets the library of preloaded models this application can switch to
+    auto SetModelLibrary(std::shared_ptr<ModelLibrary> library) -> void;
+
+    /// Returns the library of preloaded models (nullptr if none)
+    auto GetModelLibrary() const -> ModelLibrary* { return m_Library.get(); }
+
+    /// Makes the given model of the library the active simulation. Nothing is
+    /// compiled: each model keeps its own simulation, scene and rendering
+    /// context, so switching back resumes where it was left. The telemetry
+    /// channels, determinism stream and controller belong to the previous
+    /// model, so they're cleared|released (bind new ones from
+    /// _ReloadInternal). Returns false if the model isn't ready
+    auto SwitchModel(int library_id) -> bool;
+
+    /// Returns the id in the library of the active model (-1 if the active
+    /// model was loaded from file by this application)
+    auto GetActiveModel() const -> int { return m_ActiveModel; }
+
     /// Returns whether the application is still active or should close
     auto IsActive() const -> bool;
 
     /// Returns whether or not the current simulation is running without a
-    /// visualizer
+    /// visualizer (either built headless, or with the viewer detached)
     auto IsHeadless() const -> bool { return m_IsHeadless; }
 
     /// Returns the current state of the mouse
@@ -138,6 +202,49 @@ class Application {
         return m_ApplicationState;
     }
 
+    /// Sets the controller used to compute the control commands at each step
+    auto SetController(std::shared_ptr<Controller> controller) -> void {
+        m_Controller = std::move(controller);
+    }
+
+    /// Returns the controller used by this simulation (nullptr if none)
+    auto GetController() const -> Controller* { return m_Controller.get(); }
+
+    /// Sets the recorder used to store the history of the simulation
+    auto SetTelemetry(std::shared_ptr<Telemetry> telemetry) -> void {
+        m_Telemetry = std::move(telemetry);
+    }
+
+    /// Returns the recorder used by this simulation (nullptr if none)
+    auto GetTelemetry() const -> Telemetry* { return m_Telemetry.get(); }
+
+    /// Sets the checker that hashes the state after every mj_step (opt-in).
+    /// The controller runs before every mj_step, so this stream matches an
+    /// EpisodeScheduler's only when it uses a single substep per action
+    auto SetDeterminismChecker(std::shared_ptr<DeterminismChecker> checker)
+        -> void {
+        m_DeterminismChecker = std::move(checker);
+    }
+
+    /// Returns the determinism checker of this simulation (nullptr if none)
+    auto GetDeterminismChecker() const -> DeterminismChecker* {
+        return m_DeterminismChecker.get();
+    }
+
+    /// Sets the keyframe simulations are reset to (-1 for the model's default
+    /// state). Used by every model loaded|switched to from now on, and also
+    /// rebuilds the snapshot of the active model
+    auto SetResetKeyframe(int key_id) -> void;
+
+    /// Returns the keyframe simulations are reset to (-1 if the default state)
+    auto GetResetKeyframe() const -> int { return m_ResetKeyframe; }
+
+    /// Returns the snapshot used to reset this simulation
+    auto resetCache() -> ResetCache& { return *m_ResetCache; }
+
+    /// Returns the snapshot used to reset this simulation (read-only)
+    auto resetCache() const -> const ResetCache& { return *m_ResetCache; }
+
     /// Returns a mutable reference to the mjModel of this simulation
     auto model() -> mjModel& { return *m_Model; }
 
@@ -166,6 +273,24 @@ class Application {
     /// Render the base UI, exposing some simulation|render options
     auto _RenderUiCore() -> void;
 
+    /// Creates the scene, sized after the current model and budget
+    auto _MakeScene() -> void;
+
+    /// Creates the rendering context of the current model
+    auto _MakeContext() -> void;
+
+    /// Updates what depends on the active model (camera ids, user logic)
+    auto _OnModelChanged() -> void;
+
+    /// Returns the snapshot used to reset the given model (from the library,
+    /// if it has the requested initial state)
+    auto _MakeResetCache(const std::shared_ptr<mjModel>& model, int library_id)
+        -> std::shared_ptr<ResetCache>;
+
+    /// Clears the telemetry channels and the determinism stream, and releases
+    /// the controller (all of them are laid out after the active model)
+    auto _ReleaseModelBindings() -> void;
+
  protected:
     /// Implementation specific initialization step
     virtual auto _InitializeInternal() -> void{};
@@ -185,6 +310,8 @@ class Application {
  protected:
     /// Camera used to render the visualization
     mjvCamera m_Camera{};
+    /// Additional views rendered from the model's cameras
+    std::vector<Viewport> m_Viewports{};
     /// Options related to the visualiziation/scene
     mjvOption m_Option{};
     /// Buffer used to store error messages from MuJoCo
@@ -196,25 +323,67 @@ class Application {
     /// Path to the main model used for this simulation
     std::string m_Modelpath{};
 
-    /// Model struct containing the simulation structure
-    std::unique_ptr<mjModel, MjcModelDeleter> m_Model = nullptr;
+    /// Model struct containing the simulation structure (shared with the
+    /// model library, if it came from one)
+    std::shared_ptr<mjModel> m_Model = nullptr;
     /// Data struct containing simulation information
-    std::unique_ptr<mjData, MjcDataDeleter> m_Data = nullptr;
+    std::shared_ptr<mjData> m_Data = nullptr;
     /// Scene struct containing visualization information
     std::unique_ptr<mjvScene, MjvSceneDeleter> m_Scene = nullptr;
+    /// Visibility layer applied to the scene before rendering each view
+    SceneVisibility m_Visibility{};
+    /// Number of scene geoms reserved on top of the model's estimate
+    int m_SceneBudget = SCENE_DEFAULT_BUDGET;
+    /// Snapshot of the forwarded initial state, used for fast resets
+    std::shared_ptr<ResetCache> m_ResetCache = nullptr;
+    /// Keyframe the snapshot is taken from (-1 for the default state)
+    int m_ResetKeyframe = -1;
+    /// Library of preloaded models this application can switch to
+    std::shared_ptr<ModelLibrary> m_Library = nullptr;
+    /// Id in the library of the active model (-1 if loaded from file)
+    int m_ActiveModel = -1;
     /// Current state of the application
     ApplicationState m_ApplicationState{};
+    /// Controller used to compute control commands (called after the
+    /// implementation-specific simulation step)
+    std::shared_ptr<Controller> m_Controller = nullptr;
+    /// Recorder of the history of the simulation (sampled every mj_step)
+    std::shared_ptr<Telemetry> m_Telemetry = nullptr;
+    /// Checker that records the hash of the state after every mj_step
+    std::shared_ptr<DeterminismChecker> m_DeterminismChecker = nullptr;
+    /// Current state of the cursor
+    MouseState m_MouseState{};
+    /// Listener for requests to attach|detach the viewer (if enabled)
+    std::unique_ptr<ViewerControl> m_ViewerControl = nullptr;
+    /// Whether closing the window exits the application (if the application
+    /// started headless, closing the window just detaches the viewer)
+    bool m_ExitOnClose = true;
+    /// Whether or not we're running without a viewer attached
+    bool m_IsHeadless = true;
 #ifndef MUJOCOEXT_BUILD_HEADLESS
     /// Context struct containing rendering information
     std::unique_ptr<mjrContext, MjrContextDeleter> m_Context = nullptr;
     /// GLFW window created for the visualizer
     std::unique_ptr<GLFWwindow, GLFWwindowDeleter> m_Window = nullptr;
-    /// Current state of the cursor
-    MouseState m_MouseState{};
-    /// Whether or not we're running in headless mode
-    bool m_IsHeadless = false;  // might be headless if can't initialize GLFW
-#else
-    /// Whether or not we're running in headless mode
-    bool m_IsHeadless = true;  // always will be in headless
 #endif
+
+ private:
+    /// Resources of a library model while it's not the active one
+    struct ModelSlot {
+        /// Compiled model (owned by the library)
+        std::shared_ptr<mjModel> model = nullptr;
+        /// Simulation of the model (taken from the library's pool)
+        std::shared_ptr<mjData> data = nullptr;
+        /// Snapshot used to reset the simulation
+        std::shared_ptr<ResetCache> reset_cache = nullptr;
+        /// Scene created for the model
+        std::unique_ptr<mjvScene, MjvSceneDeleter> scene = nullptr;
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+        /// Rendering context created for the model (meshes, textures)
+        std::unique_ptr<mjrContext, MjrContextDeleter> context = nullptr;
+#endif
+    };
+
+    /// Resources of the library models used so far (by library id)
+    std::unordered_map<int, ModelSlot> m_ModelSlots;
 };
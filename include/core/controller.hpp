@@ -0,0 +1,37 @@
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+/// Interface for objects that compute control commands for a simulation
+class Controller {
+ public:
+    /// Creates a default controller
+    Controller() = default;
+
+    /// Releases the resources allocated by this controller
+    virtual ~Controller() = default;
+
+    /// Not copy constructable
+    Controller(const Controller& rhs) = delete;
+
+    /// Not move constructable
+    Controller(Controller&& rhs) = delete;
+
+    /// No copy operations allowed
+    auto operator=(const Controller& rhs) -> Controller& = delete;
+
+    /// No move operations allowed
+    auto operator=(Controller&& rhs) -> Controller& = delete;
+
+    /// Computes the control commands for a single simulation (writes into ctrl)
+    virtual auto Compute(const mjModel& model, mjData& data) -> void = 0;
+
+    /// Computes the control commands for a batch of simulations that share the
+    /// same model. By default just calls Compute on each element of the batch
+    virtual auto ComputeBatch(const mjModel& model, mjData* const* data_batch,
+                              int batch_size) -> void {
+        for (int i = 0; i < batch_size; ++i) {
+            Compute(model, *data_batch[i]);  // NOLINT
+        }
+    }
+};
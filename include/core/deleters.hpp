@@ -0,0 +1,33 @@
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+// Forward declared, so users of the deleters don't pull in the glfw headers
+struct GLFWwindow;
+
+/// Deleter for mjModel (when using unique_ptr)
+struct MjcModelDeleter {
+    auto operator()(mjModel* ptr) const -> void;
+};
+
+/// Deleter for mjData (when using unique_ptr)
+struct MjcDataDeleter {
+    auto operator()(mjData* ptr) const -> void;
+};
+
+/// Deleter for mjvScene (when using unique_ptr)
+struct MjvSceneDeleter {
+    auto operator()(mjvScene* ptr) const -> void;
+};
+
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+/// Deleter for mjrContext (when using unique_ptr)
+struct MjrContextDeleter {
+    auto operator()(mjrContext* ptr) const -> void;
+};
+
+/// Deleter for GLFWwindow (when using unique_ptr)
+struct GLFWwindowDeleter {
+    auto operator()(GLFWwindow* ptr) const -> void;
+};
+#endif
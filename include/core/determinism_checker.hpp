@@ -0,0 +1,150 @@
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Magic number at the start of a hash-stream file ("DET1" in little endian),
+/// followed by the index of its first step and its number of steps
+static constexpr uint32_t DETERMINISM_MAGIC = 0x31544544;
+/// Magic number of files that always start at step 0 ("DET0", still loaded)
+static constexpr uint32_t DETERMINISM_MAGIC_V0 = 0x30544544;
+/// Default number of (most recent) hashes kept by a checker
+static constexpr size_t DETERMINISM_DEFAULT_CAPACITY = 1 << 16;
+
+/// Hashes the raw bytes of the given buffer. Uses 8 independent 32-bit lanes
+/// (xxHash32-like rounds), evaluated with AVX2|NEON when available. The scalar
+/// fallback computes the exact same value, so streams can be compared across
+/// machines
+auto HashBuffer(const void* buffer, size_t num_bytes, uint32_t seed = 0)
+    -> uint32_t;
+
+/// Hashes of the physics state of a simulation after a single step
+struct StateHash {
+    /// Simulation time after the step
+    double time = 0.0;
+    /// Hash of mjData::qpos
+    uint32_t qpos = 0;
+    /// Hash of mjData::qvel
+    uint32_t qvel = 0;
+    /// Hash of mjData::act
+    uint32_t act = 0;
+    /// Hash of mjData::qacc_warmstart
+    uint32_t warmstart = 0;
+};
+
+/// Information about the first step where two runs diverged
+struct DivergenceReport {
+    /// Whether or not the runs diverged
+    bool diverged = false;
+    /// Index of the first step that differs (-1 if none)
+    long step = -1;  // NOLINT
+    /// Simulation time at that step (as recorded by the run being checked)
+    double time = 0.0;
+    /// Whether the time differs at that step
+    bool time_differs = false;
+    /// Whether qpos differs at that step
+    bool qpos_differs = false;
+    /// Whether qvel differs at that step
+    bool qvel_differs = false;
+    /// Whether act differs at that step
+    bool act_differs = false;
+    /// Whether qacc_warmstart differs at that step
+    bool warmstart_differs = false;
+    /// Whether one of the runs is shorter than the other (and they don't
+    /// differ on the steps they have in common)
+    bool length_differs = false;
+
+    /// Returns a human readable description of the divergence
+    auto ToString() const -> std::string;
+};
+
+/// Records the hash of the physics state (qpos, qvel, act, warmstart) after
+/// each step, and compares the stream against a reference run (e.g. the
+/// serial Application::Step path vs a batched|parallel twin). Only the most
+/// recent hashes are kept, but every step is checked against the reference
+/// as it's recorded, so long runs are still fully checked
+class DeterminismChecker {
+ public:
+    /// Creates an empty checker (no reference stream) keeping at most the
+    /// last capacity hashes (0 keeps all of them, e.g. to save a reference)
+    explicit DeterminismChecker(size_t capacity = DETERMINISM_DEFAULT_CAPACITY)
+        : m_Capacity(capacity) {}
+
+    /// Computes the hashes of the state of the given simulation
+    static auto Hash(const mjModel& model, const mjData& data) -> StateHash;
+
+    /// Records the hash of the current state (call it after each mj_step). If
+    /// a reference is set, the first divergence is reported right away
+    auto Record(const mjModel& model, const mjData& data) -> void;
+
+    /// Compares two hash streams and reports the first step that differs
+    static auto Compare(const std::vector<StateHash>& stream,
+                        const std::vector<StateHash>& reference)
+        -> DivergenceReport;
+
+    /// Compares the stream of this checker against another checker's (on the
+    /// steps both of them still keep)
+    auto Compare(const DeterminismChecker& reference) const
+        -> DivergenceReport;
+
+    /// Sets the stream this checker compares against while recording, whose
+    /// first hash is the one of the given step (e.g. a truncated recording)
+    auto SetReference(std::vector<StateHash> reference, size_t first_step = 0)
+        -> void;
+
+    /// Loads the stream this checker compares against from a file
+    auto LoadReference(const std::string& filepath) -> bool;
+
+    /// Saves the recorded stream into a file (only the steps still kept,
+    /// along with the index of the first of them)
+    auto Save(const std::string& filepath) const -> bool;
+
+    /// Discards the recorded stream and the current report (keeps reference)
+    auto Clear() -> void;
+
+    /// Returns the recorded stream (the most recent steps, see GetFirstStep)
+    auto GetStream() const -> const std::vector<StateHash>& { return m_Stream; }
+
+    /// Returns the index of the step of the first hash of the stream
+    auto GetFirstStep() const -> size_t { return m_FirstStep; }
+
+    /// Returns the number of steps recorded (including the dropped ones)
+    auto GetNumSteps() const -> size_t { return m_NumSteps; }
+
+    /// Returns the maximum number of hashes kept (0 means no limit)
+    auto GetCapacity() const -> size_t { return m_Capacity; }
+
+    /// Returns the result of the comparison against the reference so far
+    auto GetReport() const -> const DivergenceReport& { return m_Report; }
+
+    /// Loads a hash stream from a file, and the index of its first step
+    /// (returns false on error)
+    static auto LoadStream(const std::string& filepath,
+                           std::vector<StateHash>& stream, size_t& first_step)
+        -> bool;
+
+    /// Loads a hash stream from a file. Returns false on error, or if the
+    /// stream doesn't start at step 0 (use the overload above for those)
+    static auto LoadStream(const std::string& filepath,
+                           std::vector<StateHash>& stream) -> bool;
+
+ private:
+    /// Maximum number of hashes kept (0 means no limit)
+    size_t m_Capacity = DETERMINISM_DEFAULT_CAPACITY;
+    /// Most recent hashes recorded (oldest first)
+    std::vector<StateHash> m_Stream;
+    /// Index of the step of m_Stream[0]
+    size_t m_FirstStep = 0;
+    /// Number of steps recorded since the last Clear
+    size_t m_NumSteps = 0;
+    /// Stream to compare against while recording (can be empty)
+    std::vector<StateHash> m_Reference;
+    /// Index of the step of m_Reference[0]
+    size_t m_ReferenceFirst = 0;
+    /// First divergence found against the reference while recording
+    DivergenceReport m_Report{};
+};
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <core/controller.hpp>
+#include <core/determinism_checker.hpp>
+#include <core/reset_cache.hpp>
+#include <core/thread_pool.hpp>
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class Episode;
+class EpisodeScheduler;
+
+/// Function used to check whether or not an episode has terminated early
+using TerminationFn =
+    std::function<bool(const mjModel& model, const mjData& data)>;
+
+/// Coroutine type returned by the episode loops run by the EpisodeScheduler.
+/// The coroutine starts suspended and the scheduler is the one that resumes
+/// it (on any of its workers) and eventually destroys it
+class EpisodeTask {
+ public:
+    struct promise_type {
+        /// Episode this coroutine is running on (set by the scheduler)
+        Episode* episode = nullptr;
+
+        auto get_return_object() -> EpisodeTask {
+            return EpisodeTask(
+                std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+
+        /// Notifies the scheduler once the episode loop is done
+        struct FinalAwaiter {
+            auto await_ready() noexcept -> bool { return false; }
+            auto await_suspend(std::coroutine_handle<promise_type> handle)
+                noexcept -> void;
+            auto await_resume() noexcept -> void {}
+        };
+
+        auto final_suspend() noexcept -> FinalAwaiter { return {}; }
+
+        auto return_void() -> void {}
+
+        auto unhandled_exception() -> void { std::terminate(); }
+    };
+
+    /// Creates a task that owns the given coroutine
+    explicit EpisodeTask(std::coroutine_handle<promise_type> handle)
+        : m_Handle(handle) {}
+
+    /// Destroys the coroutine owned by this task (if any)
+    ~EpisodeTask();
+
+    /// Not copy constructable
+    EpisodeTask(const EpisodeTask& rhs) = delete;
+
+    /// Transfers the ownership of the coroutine
+    EpisodeTask(EpisodeTask&& rhs) noexcept
+        : m_Handle(std::exchange(rhs.m_Handle, nullptr)) {}
+
+    /// No copy operations allowed
+    auto operator=(const EpisodeTask& rhs) -> EpisodeTask& = delete;
+
+    /// Transfers the ownership of the coroutine
+    auto operator=(EpisodeTask&& rhs) noexcept -> EpisodeTask&;
+
+    /// Returns the handle of the coroutine owned by this task
+    auto handle() const -> std::coroutine_handle<promise_type> {
+        return m_Handle;
+    }
+
+ private:
+    /// Handle to the coroutine owned by this task
+    std::coroutine_handle<promise_type> m_Handle = nullptr;
+};
+
+/// Function that creates the coroutine running the loop of an episode
+using EpisodeFn = std::function<EpisodeTask(Episode& episode)>;
+
+/// Awaitable returned by Episode::RequestAction. Suspends the episode until
+/// the scheduler has evaluated the controller on a batch that contains it
+struct ActionAwaiter {
+    /// Episode requesting the action
+    Episode* episode = nullptr;
+
+    auto await_ready() const noexcept -> bool { return false; }
+    auto await_suspend(std::coroutine_handle<> handle) const -> void;
+    auto await_resume() const noexcept -> void {}
+};
+
+/// Single environment driven by an episode-loop coroutine
+class Episode {
+ public:
+    /// Creates an environment with its own mjData for the given model
+    Episode(EpisodeScheduler& scheduler, const mjModel& model, int id);
+
+    /// Not copy constructable
+    Episode(const Episode& rhs) = delete;
+
+    /// Not move constructable
+    Episode(Episode&& rhs) = delete;
+
+    /// No copy operations allowed
+    auto operator=(const Episode& rhs) -> Episode& = delete;
+
+    /// No move operations allowed
+    auto operator=(Episode&& rhs) -> Episode& = delete;
+
+    /// Returns an awaitable that resumes once ctrl holds the next action
+    auto RequestAction() -> ActionAwaiter { return ActionAwaiter{this}; }
+
+    /// Advances the simulation by a control period (with the current ctrl)
+    auto Step() -> void;
+
+    /// Resets the simulation to its initial configuration (starts an episode)
+    auto Reset() -> void;
+
+    /// Returns whether the current episode is over (early termination or
+    /// because it reached the maximum number of steps)
+    auto IsTerminated() const -> bool;
+
+    /// Returns the index of this environment in the scheduler
+    auto GetId() const -> int { return m_Id; }
+
+    /// Returns the number of steps taken in the current episode
+    auto GetEpisodeSteps() const -> int { return m_EpisodeSteps; }
+
+    /// Returns the number of steps taken accross all episodes
+    auto GetTotalSteps() const -> long { return m_TotalSteps; }  // NOLINT
+
+    /// Returns the number of episodes started in this environment
+    auto GetNumEpisodes() const -> int { return m_NumEpisodes; }
+
+    /// Returns the checker recording the hash of the state after every
+    /// mj_step (nullptr unless check_determinism is set in the settings)
+    auto GetDeterminismChecker() -> DeterminismChecker* {
+        return m_DeterminismChecker.get();
+    }
+
+    /// Returns the scheduler this environment belongs to
+    auto scheduler() -> EpisodeScheduler& { return m_Scheduler; }
+
+    /// Returns an unmutable reference to the mjModel of this environment
+    auto model() const -> const mjModel& { return m_Model; }
+
+    /// Returns a mutable reference to the mjData of this environment
+    auto data() -> mjData& { return *m_Data; }
+
+    /// Returns an unmutable reference to the mjData of this environment
+    auto data() const -> const mjData& { return *m_Data; }
+
+ private:
+    /// Scheduler that owns this environment
+    EpisodeScheduler& m_Scheduler;
+    /// Model shared by all environments of the scheduler
+    const mjModel& m_Model;
+    /// Data struct owned by this environment
+    std::unique_ptr<mjData, MjcDataDeleter> m_Data = nullptr;
+    /// Index of this environment in the scheduler
+    int m_Id = -1;
+    /// Number of steps taken in the current episode
+    int m_EpisodeSteps = 0;
+    /// Number of steps taken accross all episodes
+    long m_TotalSteps = 0;  // NOLINT
+    /// Number of episodes started in this environment
+    int m_NumEpisodes = 0;
+    /// Optional checker recording the hash of the state after every mj_step
+    std::unique_ptr<DeterminismChecker> m_DeterminismChecker = nullptr;
+};
+
+/// Settings used to configure the EpisodeScheduler
+struct EpisodeSchedulerSettings {
+    /// Number of environments (each one running its own episode loop)
+    int num_envs = 64;  // NOLINT
+    /// Number of worker threads (0 means one per core)
+    int num_workers = 0;
+    /// Maximum number of action requests evaluated per controller call
+    int batch_size = 32;  // NOLINT
+    /// Number of mj_step calls per action (control period)
+    int num_substeps = 1;
+    /// Maximum number of steps (actions) per episode
+    int max_episode_steps = 1000;  // NOLINT
+    /// Whether or not each environment records the hash of its state after
+    /// every mj_step (to compare it against the serial stepping path). The
+    /// controller runs once per action here, but before every mj_step in
+    /// Application::Step, so both streams only match with num_substeps = 1
+    bool check_determinism = false;
+};
+
+/// Multiplexes the episode-loop coroutines of many environments onto a fixed
+/// pool of workers. Environments that request an action are suspended and
+/// their requests coalesced into batches for the controller. A batch is sent
+/// once it's full, or as soon as no other environment can make progress, so
+/// episodes of different lengths don't wait on the slowest environment
+class EpisodeScheduler {
+ public:
+    /// Creates a scheduler whose environments share the given model
+    EpisodeScheduler(const mjModel& model,
+                     std::shared_ptr<Controller> controller,
+                     const EpisodeSchedulerSettings& settings = {});
+
+    /// Not copy constructable
+    EpisodeScheduler(const EpisodeScheduler& rhs) = delete;
+
+    /// Not move constructable
+    EpisodeScheduler(EpisodeScheduler&& rhs) = delete;
+
+    /// No copy operations allowed
+    auto operator=(const EpisodeScheduler& rhs) -> EpisodeScheduler& = delete;
+
+    /// No move operations allowed
+    auto operator=(EpisodeScheduler&& rhs) -> EpisodeScheduler& = delete;
+
+    /// Sets the function used to check for early termination of an episode
+    auto SetTerminationFn(TerminationFn termination_fn) -> void {
+        m_TerminationFn = std::move(termination_fn);
+    }
+
+    /// Runs the given episode loop on every environment, and blocks until all
+    /// of them have finished
+    auto Run(const EpisodeFn& episode_fn) -> void;
+
+    /// Runs num_episodes episodes on every environment (see EpisodeLoop)
+    auto Run(int num_episodes) -> void;
+
+    /// Default episode loop: reset, then request an action and step until the
+    /// episode terminates, repeated num_episodes times
+    static auto EpisodeLoop(Episode& episode, int num_episodes) -> EpisodeTask;
+
+    /// Returns the settings used by this scheduler
+    auto GetSettings() const -> const EpisodeSchedulerSettings& {
+        return m_Settings;
+    }
+
+    /// Returns the snapshot used to reset the environments
+    auto GetResetCache() -> ResetCache& { return *m_ResetCache; }
+
+    /// Returns the function used to check for early termination
+    auto GetTerminationFn() const -> const TerminationFn& {
+        return m_TerminationFn;
+    }
+
+    /// Returns the environments handled by this scheduler
+    auto GetEpisodes() -> std::vector<std::unique_ptr<Episode>>& {
+        return m_Episodes;
+    }
+
+    /// Returns the number of controller calls made during the last run
+    auto GetNumBatches() const -> long { return m_NumBatches; }  // NOLINT
+
+    /// Returns the total number of actions computed during the last run
+    auto GetNumActions() const -> long { return m_NumActions; }  // NOLINT
+
+ private:
+    friend struct ActionAwaiter;
+    friend struct EpisodeTask::promise_type::FinalAwaiter;
+
+    /// Registers an action request (the coroutine is already suspended)
+    auto _OnActionRequest(Episode* episode, std::coroutine_handle<> handle)
+        -> void;
+
+    /// Registers that the loop of an environment has finished
+    auto _OnEpisodeLoopDone() -> void;
+
+    /// Takes a batch from the pending requests if it should be sent now. Must
+    /// be called with m_Mutex locked
+    auto _TryTakeBatch(std::vector<Episode*>& episodes,
+                       std::vector<std::coroutine_handle<>>& handles) -> bool;
+
+    /// Evaluates the controller on a batch and resumes its coroutines
+    auto _DispatchBatch(std::vector<Episode*> episodes,
+                        std::vector<std::coroutine_handle<>> handles) -> void;
+
+ private:
+    /// Model shared by all environments
+    const mjModel& m_Model;
+    /// Controller used to compute the actions of the environments
+    std::shared_ptr<Controller> m_Controller = nullptr;
+    /// Settings of this scheduler
+    EpisodeSchedulerSettings m_Settings{};
+    /// Function used to check for early termination
+    TerminationFn m_TerminationFn = nullptr;
+    /// Snapshot of the forwarded initial state, used to reset environments
+    std::unique_ptr<ResetCache> m_ResetCache = nullptr;
+    /// Environments handled by this scheduler
+    std::vector<std::unique_ptr<Episode>> m_Episodes;
+    /// Workers used to resume the coroutines and evaluate the controller
+    std::unique_ptr<ThreadPool> m_Pool = nullptr;
+
+    /// Mutex protecting the pending requests and the counters below
+    std::mutex m_Mutex;
+    /// Signaled when all episode loops have finished
+    std::condition_variable m_CondDone;
+    /// Environments waiting for an action
+    std::vector<Episode*> m_PendingEpisodes;
+    /// Suspended coroutines of the environments waiting for an action
+    std::vector<std::coroutine_handle<>> m_PendingHandles;
+    /// Number of loops that are running, queued or inside a batch evaluation
+    int m_NumActive = 0;
+    /// Number of loops that haven't finished yet
+    int m_NumAlive = 0;
+    /// Number of controller calls made during the current run
+    long m_NumBatches = 0;  // NOLINT
+    /// Number of actions computed during the current run
+    long m_NumActions = 0;  // NOLINT
+
+    /// Serializes the calls to the controller (it may keep scratch buffers)
+    std::mutex m_ControllerMutex;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Magic number at the start of a policy file ("MLP0" in little endian)
+static constexpr uint32_t MLP_POLICY_MAGIC = 0x30504c4d;
+/// Maximum number of layers supported for a policy
+static constexpr uint32_t MLP_POLICY_MAX_LAYERS = 16;
+/// Maximum number of inputs|outputs of a single layer
+static constexpr uint32_t MLP_POLICY_MAX_LAYER_SIZE = 1U << 16U;
+/// Number of floats every layer's output is padded to (matches AVX-512 width)
+static constexpr int MLP_POLICY_LANE_WIDTH = 16;
+
+/// Activation function applied to the hidden layers of the network
+enum class MlpActivation : uint32_t {
+    TANH = 0,
+    RELU = 1,
+};
+
+/// Fully-connected network used to evaluate trained policies in-process
+///
+/// Policies are loaded from a flat binary file (little endian) with layout:
+///   uint32  magic (MLP_POLICY_MAGIC)
+///   uint32  num_layers (L)
+///   uint32  activation (see MlpActivation, applied to hidden layers only)
+///   uint32  sizes[L + 1] (input size, hidden sizes, output size)
+///   for each layer: float32 weight[out][in], float32 bias[out]
+/// which is the layout of a torch.nn.Linear stack dumped with numpy's tofile.
+class MlpPolicy {
+ public:
+    /// Creates an empty policy (use Load to fill it with weights)
+    MlpPolicy() = default;
+
+    /// Loads the weights of the network from the given file
+    auto Load(const std::string& filepath) -> bool;
+
+    /// Evaluates the network on a batch of packed observations, such that the
+    /// observation of element b starts at obs_batch[b * GetInputSize()]. The
+    /// result for element b is written at act_batch[b * GetOutputSize()]
+    auto Evaluate(const float* obs_batch, int batch_size, float* act_batch)
+        -> void;
+
+    /// Returns whether or not the policy has valid weights loaded
+    auto IsLoaded() const -> bool { return !m_Layers.empty(); }
+
+    /// Returns the size of the observations expected by this policy
+    auto GetInputSize() const -> int { return m_InputSize; }
+
+    /// Returns the size of the actions computed by this policy
+    auto GetOutputSize() const -> int { return m_OutputSize; }
+
+    /// Returns the name of the instruction set used by the kernels
+    static auto GetSimdBackend() -> const char*;
+
+ private:
+    /// Parameters of a single fully-connected layer
+    struct Layer {
+        /// Number of inputs of this layer
+        int in_size = 0;
+        /// Number of outputs of this layer
+        int out_size = 0;
+        /// Number of outputs rounded up to a multiple of the lane width
+        int out_stride = 0;
+        /// Weights stored transposed as [in][out_stride] (zero padded)
+        std::vector<float> weights;
+        /// Bias vector, zero-padded to out_stride elements
+        std::vector<float> bias;
+    };
+
+ private:
+    /// Layers of the network, from input to output
+    std::vector<Layer> m_Layers;
+    /// Activation used for the hidden layers
+    MlpActivation m_Activation = MlpActivation::TANH;
+    /// Size of the input layer
+    int m_InputSize = 0;
+    /// Size of the output layer
+    int m_OutputSize = 0;
+    /// Scratch buffers used to ping-pong activations between layers
+    std::vector<float> m_Scratch[2];
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <core/deleters.hpp>
+#include <core/reset_cache.hpp>
+#include <core/thread_pool.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Compilation status of a model in the library
+enum class ModelStatus {
+    /// Still being compiled in the background
+    PENDING,
+    /// Compiled, with its reset snapshot and pooled simulations ready
+    READY,
+    /// The model couldn't be compiled (see GetError)
+    FAILED,
+};
+
+/// Set of models compiled concurrently on background threads, and kept
+/// resident together with a snapshot of their initial state and a pool of
+/// simulations, so switching between them doesn't require compiling anything
+class ModelLibrary {
+ public:
+    /// Creates an empty library that compiles models using the given number
+    /// of threads (0 means one per core), and keeps pool_size simulations
+    /// preallocated per model
+    explicit ModelLibrary(size_t num_threads = 0, int pool_size = 1);
+
+    /// Waits for the pending compilations and releases all models
+    ~ModelLibrary() = default;
+
+    /// Not copy constructable
+    ModelLibrary(const ModelLibrary& rhs) = delete;
+
+    /// Not move constructable
+    ModelLibrary(ModelLibrary&& rhs) = delete;
+
+    /// No copy operations allowed
+    auto operator=(const ModelLibrary& rhs) -> ModelLibrary& = delete;
+
+    /// No move operations allowed
+    auto operator=(ModelLibrary&& rhs) -> ModelLibrary& = delete;
+
+    /// Queues the given xml file for compilation. Returns the id of the model
+    /// (the same id if the file had already been added)
+    auto Add(const std::string& filepath) -> int;
+
+    /// Queues all the xml files of the given folder. Returns how many models
+    /// were added
+    auto AddDirectory(const std::string& dirpath = MUJOCOEXT_RESOURCES_PATH)
+        -> int;
+
+    /// Blocks until the given model is compiled. Returns whether it's ready
+    auto Wait(int id) -> bool;
+
+    /// Blocks until all the queued models are compiled (or failed)
+    auto WaitAll() -> void;
+
+    /// Returns the id of the model with the given name (-1 if not found)
+    auto Find(const std::string& name) const -> int;
+
+    /// Returns the compilation status of the given model
+    auto GetStatus(int id) const -> ModelStatus;
+
+    /// Returns the compiled model (nullptr if not ready)
+    auto GetModel(int id) const -> std::shared_ptr<mjModel>;
+
+    /// Returns the snapshot of the initial state of the model (nullptr if not
+    /// ready). It's shared by all users of the model, so set its jitter and
+    /// mode with care
+    auto GetResetCache(int id) const -> std::shared_ptr<ResetCache>;
+
+    /// Takes a simulation of the given model from its pool (or allocates a new
+    /// one if the pool is empty), already reset to its initial state. It goes
+    /// back to the pool once released (nullptr if the model isn't ready)
+    auto Acquire(int id) -> std::shared_ptr<mjData>;
+
+    /// Returns the name of the given model (its file name without extension)
+    auto GetName(int id) const -> std::string;
+
+    /// Returns the path of the xml file of the given model
+    auto GetPath(int id) const -> std::string;
+
+    /// Returns the compilation error of the given model (if it failed)
+    auto GetError(int id) const -> std::string;
+
+    /// Returns the number of models in the library
+    auto GetNumModels() const -> int;
+
+ private:
+    /// Resources of a single model of the library
+    struct Entry {
+        /// Name of the model (file name without extension)
+        std::string name;
+        /// Path to the xml file of the model
+        std::string path;
+        /// Compilation status (READY publishes all the fields below)
+        std::atomic<ModelStatus> status{ModelStatus::PENDING};
+        /// Compilation error (if it failed)
+        std::string error;
+        /// Compiled model
+        std::shared_ptr<mjModel> model = nullptr;
+        /// Snapshot of the forwarded initial state
+        std::shared_ptr<ResetCache> reset_cache = nullptr;
+        /// Mutex protecting the pool of simulations
+        std::mutex pool_mutex;
+        /// Simulations not in use
+        std::vector<std::unique_ptr<mjData, MjcDataDeleter>> pool;
+    };
+
+    /// Compiles the model of the given entry (runs on a background thread)
+    auto _Compile(const std::shared_ptr<Entry>& entry) -> void;
+
+    /// Returns the entry with the given id (nullptr if out of range)
+    auto _GetEntry(int id) const -> std::shared_ptr<Entry>;
+
+    /// Returns the entry with the given id if it's ready (nullptr otherwise)
+    auto _GetReadyEntry(int id) const -> std::shared_ptr<Entry>;
+
+ private:
+    /// Number of simulations preallocated per model
+    int m_PoolSize = 1;
+    /// Models of the library (ids are indices into this vector)
+    std::vector<std::shared_ptr<Entry>> m_Entries;
+    /// Mutex protecting the list of entries and the pending counter
+    mutable std::mutex m_Mutex;
+    /// Signaled when a model finishes compiling (or fails)
+    std::condition_variable m_CondCompiled;
+    /// Number of models still being compiled
+    int m_NumPending = 0;
+    /// Threads compiling the models (destroyed first, so pending
+    /// compilations finish while the entries are still alive)
+    ThreadPool m_Pool;
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <core/controller.hpp>
+#include <core/deleters.hpp>
+#include <core/numa_topology.hpp>
+#include <core/reset_cache.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// Execution options of a NumaStepper
+struct NumaStepperSettings {
+    /// Number of worker threads (0 means one per usable cpu)
+    int num_threads = 0;
+    /// Pin each worker to its own cpu (spread evenly across the nodes)
+    bool pin_threads = true;
+    /// Keep one copy of the model per node, made by a worker of that node
+    bool replicate_model = true;
+    /// Allocate each simulation from the worker that steps it, so its memory
+    /// is first touched (and thus placed) on that worker's node
+    bool local_data = true;
+    /// Number of mj_step calls per control step
+    int num_substeps = 1;
+};
+
+/// Steps a batch of simulations of the same model on a fixed set of worker
+/// threads. Each worker always owns the same contiguous slice of
+/// environments, so with pinning enabled their memory stays on the node of
+/// the cpu that steps them, and reads of the (read-only) model hit a copy on
+/// that same node. Memory placement relies on the first-touch policy of the
+/// operating system, so no NUMA library is required
+class NumaStepper {
+ public:
+    /// Creates the workers, the per-node copies of the model, and num_envs
+    /// simulations reset to the initial state of the model
+    NumaStepper(const mjModel& model, int num_envs,
+                NumaStepperSettings settings = {},
+                const NumaTopology& topology = NumaTopology::Detect());
+
+    /// Stops and joins all workers
+    ~NumaStepper();
+
+    /// Not copy constructable
+    NumaStepper(const NumaStepper& rhs) = delete;
+
+    /// Not move constructable
+    NumaStepper(NumaStepper&& rhs) = delete;
+
+    /// No copy operations allowed
+    auto operator=(const NumaStepper& rhs) -> NumaStepper& = delete;
+
+    /// No move operations allowed
+    auto operator=(NumaStepper&& rhs) -> NumaStepper& = delete;
+
+    /// Advances all environments by the given number of control steps, and
+    /// blocks until every worker is done
+    auto Step(int num_steps = 1) -> void;
+
+    /// Restores all environments to the initial state of the model
+    auto Reset() -> void;
+
+    /// Sets the controller used before each control step, shared by all the
+    /// workers. Its calls (one ComputeBatch per slice) are serialized, as it
+    /// may keep scratch buffers (replaces the per-worker controllers)
+    auto SetController(std::shared_ptr<Controller> controller) -> void;
+
+    /// Creates one controller per worker with the given factory, so each
+    /// slice is controlled in parallel (replaces the shared controller)
+    auto SetControllerFactory(
+        const std::function<std::shared_ptr<Controller>()>& factory) -> void;
+
+    /// Returns the simulation of the given environment
+    auto GetData(int env) -> mjData& { return *m_Data[env]; }
+
+    /// Returns the copy of the model used to step the given environment
+    auto GetModel(int env) const -> const mjModel&;
+
+    /// Returns the number of environments
+    auto GetNumEnvs() const -> int { return static_cast<int>(m_Data.size()); }
+
+    /// Returns the number of worker threads
+    auto GetNumThreads() const -> int {
+        return static_cast<int>(m_Workers.size());
+    }
+
+    /// Returns the number of copies of the model in use
+    auto GetNumReplicas() const -> int {
+        return static_cast<int>(m_Replicas.size());
+    }
+
+    /// Returns the number of workers that were successfully pinned
+    auto GetNumPinned() const -> int;
+
+    /// Returns the topology the workers were laid out on
+    auto topology() const -> const NumaTopology& { return m_Topology; }
+
+ private:
+    /// Work requested from the workers
+    enum class Command {
+        /// Make the copies of the model (run by the first worker of each node)
+        REPLICATE,
+        /// Allocate and reset the simulations of each worker
+        ALLOCATE,
+        /// Step the simulations of each worker
+        STEP,
+        /// Reset the simulations of each worker
+        RESET,
+        /// Exit the worker loop
+        STOP,
+    };
+
+    /// A copy of the model shared by the workers of a node
+    struct Replica {
+        /// Copy of the model (nullptr when using the original model)
+        std::unique_ptr<mjModel, MjcModelDeleter> copy = nullptr;
+        /// Model used by the workers (either the copy or the original)
+        const mjModel* model = nullptr;
+        /// Snapshot of the initial state of the model
+        std::unique_ptr<ResetCache> reset_cache = nullptr;
+    };
+
+    /// A worker thread and the slice of environments it owns
+    struct Worker {
+        /// Cpu the worker runs on (-1 if not pinned)
+        int cpu = -1;
+        /// Whether the worker was successfully pinned to its cpu
+        bool pinned = false;
+        /// Index of the replica used by the worker
+        int replica = 0;
+        /// Whether this worker makes the copy of the model of its replica
+        bool makes_replica = false;
+        /// First environment of the slice
+        int env_begin = 0;
+        /// One past the last environment of the slice
+        int env_end = 0;
+        /// Controller owned by this worker (nullptr to use the shared one)
+        std::shared_ptr<Controller> controller = nullptr;
+        /// Thread running the worker loop
+        std::thread thread;
+    };
+
+    /// Main loop run by each of the workers
+    auto _WorkerLoop(int index) -> void;
+
+    /// Runs the given command on the given worker
+    auto _Execute(Worker& worker, Command command, int num_steps) -> void;
+
+    /// Sends a command to all workers and blocks until all of them are done
+    auto _Dispatch(Command command, int num_steps = 0) -> void;
+
+ private:
+    /// Execution options
+    NumaStepperSettings m_Settings;
+    /// Topology the workers were laid out on
+    NumaTopology m_Topology;
+    /// Model the replicas are copied from
+    const mjModel* m_SourceModel = nullptr;
+    /// Copies of the model (one per node in use, or just the original)
+    std::vector<Replica> m_Replicas;
+    /// Simulations of all environments
+    std::vector<std::unique_ptr<mjData, MjcDataDeleter>> m_Data;
+    /// Raw pointers to the simulations, used for batched control
+    std::vector<mjData*> m_DataPtrs;
+    /// Optional controller run before each control step
+    std::shared_ptr<Controller> m_Controller = nullptr;
+    /// Serializes the calls to the shared controller
+    std::mutex m_ControllerMutex;
+    /// Worker threads and their slices
+    std::vector<Worker> m_Workers;
+    /// Mutex protecting the command state below
+    std::mutex m_Mutex;
+    /// Signaled when a new command is issued
+    std::condition_variable m_CondCommand;
+    /// Signaled when the last worker finishes the current command
+    std::condition_variable m_CondDone;
+    /// Current command
+    Command m_Command = Command::STOP;
+    /// Number of control steps of the current command
+    int m_NumSteps = 0;
+    /// Incremented on each command, so workers know there's new work
+    uint64_t m_Generation = 0;
+    /// Number of workers that haven't finished the current command
+    int m_NumPending = 0;
+};
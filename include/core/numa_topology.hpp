@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/// A NUMA node and the cpus attached to it
+struct NumaNode {
+    /// Index of the node (as reported by the operating system)
+    int id = 0;
+    /// Cpus of the node that this process is allowed to run on
+    std::vector<int> cpus;
+};
+
+/// NUMA layout of the machine, read from /sys/devices/system/node (Linux).
+/// Other platforms, or machines without that information, are reported as a
+/// single node with all the cpus the process can run on
+class NumaTopology {
+ public:
+    /// Detects the topology of the machine this process is running on
+    static auto Detect() -> NumaTopology;
+
+    /// Creates a single-node topology with the given cpus
+    static auto SingleNode(std::vector<int> cpus) -> NumaTopology;
+
+    /// Parses a cpu list like "0-3,8,10-11" (returns an empty list on error)
+    static auto ParseCpuList(const std::string& cpu_list) -> std::vector<int>;
+
+    /// Pins the calling thread to the given cpu. Returns false if pinning
+    /// isn't supported or failed
+    static auto PinCurrentThread(int cpu) -> bool;
+
+    /// Returns the nodes with at least one usable cpu
+    auto GetNodes() const -> const std::vector<NumaNode>& { return m_Nodes; }
+
+    /// Returns the number of nodes
+    auto GetNumNodes() const -> int { return static_cast<int>(m_Nodes.size()); }
+
+    /// Returns the total number of usable cpus
+    auto GetNumCpus() const -> int;
+
+    /// Returns the cpus ordered so that consecutive workers alternate between
+    /// nodes (worker i runs on node i % num_nodes), which balances the load
+    /// of a partial set of workers across the sockets
+    auto GetInterleavedCpus() const -> std::vector<int>;
+
+    /// Returns the index (into GetNodes) of the node of the given cpu (-1 if
+    /// the cpu isn't part of the topology)
+    auto GetNodeOfCpu(int cpu) const -> int;
+
+    /// Returns a human readable description of the topology
+    auto ToString() const -> std::string;
+
+ private:
+    /// Nodes with at least one usable cpu
+    std::vector<NumaNode> m_Nodes;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <core/controller.hpp>
+#include <core/mlp_policy.hpp>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/// Function used to write the observation of a simulation into a buffer
+using ObservationFn =
+    std::function<void(const mjModel& model, const mjData& data, float* obs)>;
+
+/// Controller that evaluates an MlpPolicy in-process. Observations of all
+/// simulations in a batch are packed into a single buffer, evaluated in one
+/// call, and the resulting actions are written back into each ctrl buffer
+class PolicyController : public Controller {
+ public:
+    /// Creates a controller for the given policy. If no observation function
+    /// is given, the observation is the concatenation of qpos and qvel. The
+    /// policy must output one action per actuator (and, with the default
+    /// observation, take nq + nv inputs), otherwise no controls are computed
+    explicit PolicyController(std::shared_ptr<MlpPolicy> policy,
+                              ObservationFn observation_fn = nullptr);
+
+    /// Computes the control commands for a single simulation
+    auto Compute(const mjModel& model, mjData& data) -> void override;
+
+    /// Computes the control commands for a batch of simulations
+    auto ComputeBatch(const mjModel& model, mjData* const* data_batch,
+                      int batch_size) -> void override;
+
+    /// Returns the policy evaluated by this controller
+    auto policy() -> MlpPolicy& { return *m_Policy; }
+
+    /// Returns the policy evaluated by this controller (read-only)
+    auto policy() const -> const MlpPolicy& { return *m_Policy; }
+
+ private:
+    /// Checks the sizes of the policy against the model (logs a mismatch)
+    auto _IsCompatible(const mjModel& model) -> bool;
+
+ private:
+    /// Policy used to compute the actions
+    std::shared_ptr<MlpPolicy> m_Policy = nullptr;
+    /// Function used to build the observation of each simulation
+    ObservationFn m_ObservationFn = nullptr;
+    /// Whether the observation is the default concatenation of qpos and qvel
+    bool m_DefaultObservation = false;
+    /// Last model rejected by _IsCompatible (so mismatches are logged once)
+    const mjModel* m_RejectedModel = nullptr;
+    /// Packed observations for the whole batch
+    std::vector<float> m_ObsBuffer;
+    /// Packed actions for the whole batch
+    std::vector<float> m_ActBuffer;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <core/deleters.hpp>
+#include <core/thread_pool.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+/// Function used to add noise to a simulation right after it's been reset.
+/// Receives the index of the simulation in the batch (0 for single resets),
+/// and might be called concurrently from different workers for batched resets
+using ResetJitterFn =
+    std::function<void(const mjModel& model, mjData& data, int index)>;
+
+/// Which parts of the snapshot are copied back when restoring a simulation
+enum class ResetMode {
+    /// Copy the whole mjData (same result as mj_resetData + mj_forward)
+    FULL,
+    /// Copy only the state (time, qpos, qvel, act, warmstart, controls,
+    /// applied forces, mocap, userdata, plugin state and active equality
+    /// constraints, i.e. mjSTATE_INTEGRATION). Derived quantities like xpos or
+    /// sensordata become stale until the next mj_step|mj_forward, but the
+    /// trajectory from there on is the same as with a FULL reset
+    STATE,
+};
+
+/// Snapshot of a fully forwarded initial mjData (the default initial state of
+/// the model, or one of its keyframes). Resetting a simulation then becomes a
+/// bulk copy from the snapshot, instead of mj_resetData plus mj_forward
+class ResetCache {
+ public:
+    /// Creates a snapshot of the given model (key_id < 0 uses the default
+    /// initial state, otherwise the keyframe with the given index)
+    explicit ResetCache(const mjModel& model, int key_id = -1);
+
+    /// Not copy constructable
+    ResetCache(const ResetCache& rhs) = delete;
+
+    /// Not move constructable
+    ResetCache(ResetCache&& rhs) = delete;
+
+    /// No copy operations allowed
+    auto operator=(const ResetCache& rhs) -> ResetCache& = delete;
+
+    /// No move operations allowed
+    auto operator=(ResetCache&& rhs) -> ResetCache& = delete;
+
+    /// Recomputes the snapshot (call it after editing the model's parameters)
+    auto Capture() -> void;
+
+    /// Restores the given simulation from the snapshot (then applies jitter)
+    auto Restore(mjData& data, int index = 0) const -> void;
+
+    /// Restores the simulations of the batch whose mask entry is non-zero (or
+    /// all of them if mask is nullptr). Uses the pool if given one
+    auto RestoreBatch(mjData* const* data_batch, int batch_size,
+                      const uint8_t* mask = nullptr,
+                      ThreadPool* pool = nullptr) const -> void;
+
+    /// Sets the function used to add noise after each restore
+    auto SetJitterFn(ResetJitterFn jitter_fn) -> void {
+        m_JitterFn = std::move(jitter_fn);
+    }
+
+    /// Sets which parts of the snapshot are copied back when restoring
+    auto SetMode(ResetMode mode) -> void { m_Mode = mode; }
+
+    /// Returns which parts of the snapshot are copied back when restoring
+    auto GetMode() const -> ResetMode { return m_Mode; }
+
+    /// Returns the index of the keyframe used (-1 for the default state)
+    auto GetKeyId() const -> int { return m_KeyId; }
+
+    /// Returns the snapshot of the forwarded initial state
+    auto snapshot() const -> const mjData& { return *m_Snapshot; }
+
+ private:
+    /// Model the snapshot was created for
+    const mjModel& m_Model;
+    /// Forwarded initial state
+    std::unique_ptr<mjData, MjcDataDeleter> m_Snapshot = nullptr;
+    /// Index of the keyframe used (-1 for the default state)
+    int m_KeyId = -1;
+    /// Which parts of the snapshot are copied back
+    ResetMode m_Mode = ResetMode::FULL;
+    /// Optional function used to add noise after each restore
+    ResetJitterFn m_JitterFn = nullptr;
+};
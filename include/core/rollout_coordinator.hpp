@@ -0,0 +1,185 @@
+#pragma once
+
+#include <core/rollout_protocol.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/// Settings used by the coordinator to hand out and track chunks
+struct RolloutCoordinatorSettings {
+    /// Seconds before an in-flight chunk is considered lost (its worker is
+    /// dropped and the chunk is handed out again)
+    double chunk_timeout = 60.0;
+    /// Chunks running for longer than this factor times the average chunk
+    /// duration are duplicated onto idle workers (first result wins)
+    double straggler_factor = 2.0;
+    /// Seconds Run waits without any connected worker before giving up
+    double no_worker_timeout = 10.0;
+    /// Seconds a single message can take to be sent|received before the
+    /// worker is considered lost (e.g. it died halfway through a message).
+    /// Partial messages are buffered, so receiving never blocks the others
+    double io_timeout = 5.0;
+    /// Timeout (in milliseconds) of each poll on the sockets
+    int poll_interval_ms = 20;
+};
+
+/// Counters collected by the coordinator during the last call to Run
+struct RolloutStats {
+    /// Number of chunks handed out (including re-issued ones)
+    size_t num_dispatched = 0;
+    /// Number of chunks taken from another worker's queue
+    size_t num_stolen = 0;
+    /// Number of chunks duplicated because their worker was too slow
+    size_t num_speculative = 0;
+    /// Number of chunks handed out again because their worker was lost
+    size_t num_reissued = 0;
+    /// Number of results discarded because the chunk was already done
+    size_t num_duplicates = 0;
+    /// Number of workers lost (crashed, disconnected or timed out)
+    size_t num_lost_workers = 0;
+    /// Wall-clock duration of the run in seconds
+    double duration = 0.0;
+};
+
+/// Hands out rollout chunks to worker processes connected through unix (or
+/// TCP) sockets, and gathers their results. Each worker has its own queue of
+/// contiguous chunks; idle workers steal from the back of the longest queue,
+/// chunks of lost workers are handed out again, and slow chunks are
+/// duplicated onto idle workers, so no single worker can stall the batch
+class RolloutCoordinator {
+ public:
+    /// Creates a coordinator (call Listen before spawning the workers)
+    explicit RolloutCoordinator(RolloutCoordinatorSettings settings = {});
+
+    /// Shuts down the workers and closes all sockets
+    ~RolloutCoordinator();
+
+    /// Not copy constructable
+    RolloutCoordinator(const RolloutCoordinator& rhs) = delete;
+
+    /// Not move constructable
+    RolloutCoordinator(RolloutCoordinator&& rhs) = delete;
+
+    /// No copy operations allowed
+    auto operator=(const RolloutCoordinator& rhs)
+        -> RolloutCoordinator& = delete;
+
+    /// No move operations allowed
+    auto operator=(RolloutCoordinator&& rhs) -> RolloutCoordinator& = delete;
+
+    /// Starts listening for workers at the given address (a unix-socket path,
+    /// or tcp://host:port)
+    auto Listen(const std::string& address) -> bool;
+
+    /// Accepts connections until the given number of workers is connected, or
+    /// the timeout (in seconds) expires. Returns the number of workers
+    auto WaitForWorkers(size_t num_workers, double timeout) -> size_t;
+
+    /// Hands out the given chunks and blocks until all results are gathered.
+    /// Returns false if the chunks couldn't be completed (no workers left)
+    auto Run(const std::vector<RolloutChunk>& chunks) -> bool;
+
+    /// Sends the shutdown message to all workers and closes their sockets
+    auto Shutdown() -> void;
+
+    /// Splits num_envs environments into chunks of (at most) chunk_size
+    static auto MakeChunks(uint32_t num_envs, uint32_t chunk_size,
+                           uint32_t num_steps, uint32_t seed = 0)
+        -> std::vector<RolloutChunk>;
+
+    /// Returns the serialized results of each chunk of the last run
+    auto GetResults() const -> const std::vector<std::vector<uint8_t>>& {
+        return m_Results;
+    }
+
+    /// Returns the counters of the last run
+    auto GetStats() const -> const RolloutStats& { return m_Stats; }
+
+    /// Returns the number of connected workers
+    auto GetNumWorkers() const -> size_t { return m_Workers.size(); }
+
+ private:
+    using Clock = std::chrono::steady_clock;
+
+    /// State of a connected worker process
+    struct WorkerState {
+        /// Socket connected to the worker
+        int socket_fd = -1;
+        /// Process id reported by the worker
+        int64_t pid = -1;
+        /// Chunks (indices into the current run) assigned to this worker
+        std::deque<size_t> queue;
+        /// Whether the worker is waiting for a chunk
+        bool waiting = false;
+        /// Chunk the worker is simulating (-1 if none)
+        int64_t current = -1;
+        /// When the current chunk was handed out
+        Clock::time_point start{};
+        /// Whether the worker has been lost (removed after each poll)
+        bool lost = false;
+        /// Bytes received that don't form a whole message yet
+        std::vector<uint8_t> buffer;
+        /// When the first bytes of the incomplete message were received
+        Clock::time_point receive_start{};
+    };
+
+    /// Progress of a chunk of the current run
+    struct ChunkState {
+        /// Whether the result has been received
+        bool done = false;
+        /// Number of workers currently simulating this chunk
+        int num_running = 0;
+        /// When the chunk started running (with no other copy in flight)
+        Clock::time_point start{};
+    };
+
+    /// Accepts all pending connections
+    auto _AcceptWorkers() -> void;
+
+    /// Reads what the given worker has sent (without blocking), and handles
+    /// each of the complete messages
+    auto _ReceiveMessages(WorkerState& worker) -> void;
+
+    /// Handles a message received from the given worker
+    auto _HandleMessage(WorkerState& worker, const RolloutMessage& message)
+        -> void;
+
+    /// Picks the next chunk for the given worker (-1 if none)
+    auto _NextChunk(WorkerState& worker) -> int64_t;
+
+    /// Marks the worker as lost and hands its chunks to the orphan queue
+    auto _DropWorker(WorkerState& worker) -> void;
+
+    /// Removes the workers that have been marked as lost
+    auto _RemoveLostWorkers() -> void;
+
+ private:
+    /// Settings used to hand out and track chunks
+    RolloutCoordinatorSettings m_Settings;
+    /// Address the coordinator is listening at
+    std::string m_Address;
+    /// Listening socket (-1 if not listening)
+    int m_ListenFd = -1;
+    /// Connected workers
+    std::vector<WorkerState> m_Workers;
+    /// Chunks of the current run
+    std::vector<RolloutChunk> m_Chunks;
+    /// Progress of each chunk of the current run
+    std::vector<ChunkState> m_ChunkStates;
+    /// Chunks not owned by any worker (lost, or no workers at the start)
+    std::deque<size_t> m_Orphans;
+    /// Serialized results of each chunk of the current run
+    std::vector<std::vector<uint8_t>> m_Results;
+    /// Number of chunks of the current run whose result has been received
+    size_t m_NumDone = 0;
+    /// Sum of the durations of the completed chunks (in seconds)
+    double m_TotalChunkTime = 0.0;
+    /// Index of the current run (upper 32 bits of the ids sent to workers)
+    uint64_t m_RunIndex = 0;
+    /// Counters of the current run
+    RolloutStats m_Stats{};
+};
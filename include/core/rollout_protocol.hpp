@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Magic number at the start of every message ("ROL0" in little endian)
+static constexpr uint32_t ROLLOUT_MAGIC = 0x304c4f52;
+/// Maximum size of the payload of a single message (64 MiB)
+static constexpr uint32_t ROLLOUT_MAX_PAYLOAD = 1U << 26U;
+/// Prefix used to select a TCP address instead of a unix-socket path
+static constexpr const char* ROLLOUT_TCP_PREFIX = "tcp://";
+
+/// Types of the messages exchanged between coordinator and workers
+enum class RolloutMessageType : uint32_t {
+    /// Worker -> coordinator: the worker is ready (payload: pid)
+    HELLO = 0,
+    /// Worker -> coordinator: the worker wants a new chunk (no payload). The
+    /// coordinator holds the request until it has a chunk for the worker
+    REQUEST = 1,
+    /// Coordinator -> worker: chunk to be simulated (payload: RolloutChunk)
+    CHUNK = 2,
+    /// Worker -> coordinator: results of a chunk (payload: chunk id + data)
+    RESULT = 3,
+    /// Coordinator -> worker: the worker should exit
+    SHUTDOWN = 4,
+};
+
+/// Header sent before the payload of every message
+struct RolloutMessageHeader {
+    uint32_t magic = ROLLOUT_MAGIC;
+    uint32_t type = 0;
+    uint32_t payload_size = 0;
+};
+
+/// Unit of work handed out by the coordinator: a batch of environments that
+/// are reset and then simulated for a number of steps
+struct RolloutChunk {
+    /// Unique identifier of the chunk
+    uint64_t id = 0;
+    /// Global index of the first environment of the chunk
+    uint32_t env_begin = 0;
+    /// Number of environments in the chunk
+    uint32_t num_envs = 0;
+    /// Number of control steps to simulate each environment for
+    uint32_t num_steps = 0;
+    /// Seed used to randomize the initial state of the environments
+    uint32_t seed = 0;
+};
+
+/// A message received through a rollout connection
+struct RolloutMessage {
+    /// Type of the message
+    RolloutMessageType type = RolloutMessageType::HELLO;
+    /// Raw payload of the message
+    std::vector<uint8_t> payload;
+};
+
+/// Outcome of extracting a message from a receive buffer
+enum class RolloutParseResult {
+    /// The buffer doesn't hold a whole message yet
+    INCOMPLETE,
+    /// A whole message was extracted
+    MESSAGE,
+    /// The buffer holds a corrupt header (the connection should be dropped)
+    INVALID,
+};
+
+/// Creates a listening socket at the given address (a unix-socket path, or
+/// tcp://host:port). Returns the file descriptor, or -1 on error. All sockets
+/// created by these functions are closed on exec
+auto RolloutListen(const std::string& address, int backlog) -> int;
+
+/// Connects to a listening socket at the given address. Returns the file
+/// descriptor, or -1 on error
+auto RolloutConnect(const std::string& address) -> int;
+
+/// Accepts a pending connection on the given listening socket. Returns the
+/// file descriptor of the (blocking) connection, or -1 if none is pending
+auto RolloutAccept(int listen_fd) -> int;
+
+/// Sets the timeout (in seconds) of blocking sends|receives on the socket
+auto RolloutSetTimeout(int socket_fd, double seconds) -> void;
+
+/// Closes the given socket (and removes it if it's a listening unix socket)
+auto RolloutClose(int socket_fd, const std::string& address = "") -> void;
+
+/// Sends a whole message (header + payload). Returns false on error
+auto RolloutSend(int socket_fd, RolloutMessageType type, const void* payload,
+                 size_t payload_size) -> bool;
+
+/// Receives a whole message (blocks until complete). Returns false on error
+/// or if the connection was closed
+auto RolloutReceive(int socket_fd, RolloutMessage& message) -> bool;
+
+/// Appends the bytes already available on the socket to the buffer (never
+/// blocks). Returns false on error or if the connection was closed
+auto RolloutReceiveAvailable(int socket_fd, std::vector<uint8_t>& buffer)
+    -> bool;
+
+/// Extracts the message starting at the given offset of the buffer, and
+/// advances the offset past it if it's complete
+auto RolloutParseMessage(const std::vector<uint8_t>& buffer, size_t& offset,
+                         RolloutMessage& message) -> RolloutParseResult;
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <core/controller.hpp>
+#include <core/deleters.hpp>
+#include <core/reset_cache.hpp>
+#include <core/rollout_protocol.hpp>
+#include <core/thread_pool.hpp>
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Function that serializes the results of a chunk once it's been simulated.
+/// Appends its bytes to result (by default one StateHash per environment)
+using RolloutResultFn = std::function<void(
+    const mjModel& model, mjData* const* data_batch, const RolloutChunk& chunk,
+    std::vector<uint8_t>& result)>;
+
+/// Settings used by a worker to simulate the chunks it receives
+struct RolloutWorkerSettings {
+    /// Number of mj_step calls per control step
+    int num_substeps = 1;
+    /// Number of threads used to step the environments of a chunk
+    int num_threads = 1;
+    /// Amplitude of the uniform noise added to the hinge|slide joints on reset
+    /// (seeded by the chunk's seed and the environment's global index)
+    double jitter_scale = 0.0;
+    /// Number of attempts to connect to the coordinator (50ms apart)
+    int connect_attempts = 100;
+};
+
+/// Process that loads a model once, and then simulates the chunks of
+/// environments handed out by a RolloutCoordinator until told to shut down
+class RolloutWorker {
+ public:
+    /// Creates a worker that shares an already compiled model (e.g. the copy
+    /// inherited from the parent after fork)
+    explicit RolloutWorker(const mjModel& model,
+                           RolloutWorkerSettings settings = {});
+
+    /// Creates a worker that compiles its own copy of the given model
+    explicit RolloutWorker(const std::string& model_path,
+                           RolloutWorkerSettings settings = {});
+
+    /// Not copy constructable
+    RolloutWorker(const RolloutWorker& rhs) = delete;
+
+    /// Not move constructable
+    RolloutWorker(RolloutWorker&& rhs) = delete;
+
+    /// No copy operations allowed
+    auto operator=(const RolloutWorker& rhs) -> RolloutWorker& = delete;
+
+    /// No move operations allowed
+    auto operator=(RolloutWorker&& rhs) -> RolloutWorker& = delete;
+
+    /// Releases the resources of this worker
+    ~RolloutWorker();
+
+    /// Connects to the coordinator at the given address and serves chunks
+    /// until shut down. Returns the number of chunks simulated, or -1 if it
+    /// couldn't connect
+    auto Run(const std::string& address) -> int;
+
+    /// Forks num_workers processes that share the given (compiled) model and
+    /// serve the coordinator at the given address. The setup function runs in
+    /// each child before serving (e.g. to set a controller). Children close
+    /// every inherited file descriptor but the standard streams, and should
+    /// be spawned before the parent starts any thread. Returns the pids
+    static auto SpawnLocal(
+        int num_workers, const mjModel& model, const std::string& address,
+        RolloutWorkerSettings settings = {},
+        const std::function<void(RolloutWorker&)>& setup_fn = nullptr)
+        -> std::vector<pid_t>;
+
+    /// Sets the controller used to compute the actions (batched per chunk)
+    auto SetController(std::shared_ptr<Controller> controller) -> void {
+        m_Controller = std::move(controller);
+    }
+
+    /// Sets the function used to serialize the results of each chunk
+    auto SetResultFn(RolloutResultFn result_fn) -> void {
+        m_ResultFn = std::move(result_fn);
+    }
+
+    /// Returns the model simulated by this worker
+    auto model() const -> const mjModel& { return *m_Model; }
+
+ private:
+    /// Allocates the resources shared by all chunks
+    auto _Init() -> void;
+
+    /// Simulates the given chunk, and serializes its results after chunk id
+    auto _RunChunk(const RolloutChunk& chunk, std::vector<uint8_t>& result)
+        -> void;
+
+ private:
+    /// Model compiled by this worker (if not sharing one)
+    std::unique_ptr<mjModel, MjcModelDeleter> m_OwnedModel = nullptr;
+    /// Model simulated by this worker
+    const mjModel* m_Model = nullptr;
+    /// Settings used to simulate the chunks
+    RolloutWorkerSettings m_Settings;
+    /// Simulations reused across chunks (grown to the largest chunk)
+    std::vector<std::unique_ptr<mjData, MjcDataDeleter>> m_Data;
+    /// Raw pointers to the simulations (as expected by the batched APIs)
+    std::vector<mjData*> m_DataPtrs;
+    /// Snapshot of the initial state each environment is reset to
+    std::unique_ptr<ResetCache> m_ResetCache = nullptr;
+    /// Pool used to step the environments of a chunk in parallel
+    std::unique_ptr<ThreadPool> m_Pool = nullptr;
+    /// Optional controller that computes the actions
+    std::shared_ptr<Controller> m_Controller = nullptr;
+    /// Function used to serialize the results of each chunk
+    RolloutResultFn m_ResultFn = nullptr;
+};
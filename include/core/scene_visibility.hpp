@@ -0,0 +1,88 @@
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <cstddef>
+#include <vector>
+
+/// Default number of scene geoms reserved on top of the model's estimate (for
+/// contacts, perturbations, labels, and user-added geoms)
+static constexpr int SCENE_DEFAULT_BUDGET = 500;
+
+/// Options of the visibility layer applied to the scene before rendering
+struct SceneVisibilitySettings {
+    /// Categories of geoms produced by mjv_updateScene (mjtCatBit mask)
+    int category_mask = mjCAT_ALL;
+    /// Whether geoms outside the camera's frustum are dropped before render.
+    /// Off by default: off-screen geoms can still cast shadows or show up in
+    /// reflective planes, which disappear once those geoms are culled
+    bool frustum_culling = false;
+    /// Extra radius added to the bounds of each geom when culling. Should
+    /// cover the distance at which shadow casters and reflected geoms matter
+    /// for the scene (e.g. the extent of the reflective floor)
+    float cull_margin = 0.0F;
+    /// Decor geoms further than this distance from the camera are decimated:
+    /// only one in (1 + distance / decor_distance) is kept. 0 disables it
+    float decor_distance = 0.0F;
+};
+
+/// Visibility layer on top of a mjvScene: sizes the scene from the model, and
+/// filters the geoms produced by mjv_updateScene for each rendered view.
+/// Disabled categories|groups are never produced (they are masked out before
+/// mjv_updateScene), while off-screen geoms are dropped before mjr_render
+class SceneVisibility {
+ public:
+    /// Creates a visibility layer with the given settings
+    explicit SceneVisibility(SceneVisibilitySettings settings = {})
+        : m_Settings(settings) {}
+
+    /// Returns the number of scene geoms required by the given model: its
+    /// geoms, an estimate of its decor (sites, joints, bodies, tendons,
+    /// actuators, cameras and lights), plus the given budget
+    static auto ComputeCapacity(const mjModel& model, int budget) -> int;
+
+    /// Keeps a copy of the geoms produced by mjv_updateScene, so several views
+    /// can be culled from the same scene (otherwise, Cull works in place)
+    auto Capture(const mjvScene& scene) -> void;
+
+    /// Forgets the captured geoms (Cull goes back to working in place)
+    auto Release() -> void { m_Captured = false; }
+
+    /// Keeps only the geoms visible from the scene's current camera, rendered
+    /// into a viewport of the given size. Returns the number of geoms kept
+    auto Cull(mjvScene& scene, const mjrRect& viewport) -> int;
+
+    /// Shows the visibility options (categories, groups, culling, decor)
+    auto RenderUi(mjvOption& option) -> void;
+
+    /// Returns the settings of this layer
+    auto settings() -> SceneVisibilitySettings& { return m_Settings; }
+
+    /// Returns the settings of this layer (read-only)
+    auto settings() const -> const SceneVisibilitySettings& {
+        return m_Settings;
+    }
+
+    /// Returns the number of geoms produced by the last scene update
+    auto GetNumProduced() const -> int { return m_NumProduced; }
+
+    /// Returns the number of geoms kept by the last call to Cull
+    auto GetNumVisible() const -> int { return m_NumVisible; }
+
+ private:
+    /// Returns whether the given geom should be rendered from the camera
+    auto _IsVisible(const mjvGeom& geom, const mjvGLCamera& camera,
+                    float aspect) const -> bool;
+
+ private:
+    /// Options of this layer
+    SceneVisibilitySettings m_Settings;
+    /// Copy of the geoms produced by the last scene update (if captured)
+    std::vector<mjvGeom> m_Geoms;
+    /// Whether Cull reads from the captured geoms
+    bool m_Captured = false;
+    /// Number of geoms produced by the last scene update
+    int m_NumProduced = 0;
+    /// Number of geoms kept by the last call to Cull
+    int m_NumVisible = 0;
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Default number of samples kept per channel (about 6.5 sec. at 10 kHz)
+static constexpr size_t TELEMETRY_DEFAULT_CAPACITY = 1 << 16;
+/// Number of bins used to draw the decimated plots of each channel
+static constexpr int TELEMETRY_PLOT_BINS = 256;
+/// Default file the recorded samples are exported to
+static constexpr const char* TELEMETRY_DEFAULT_EXPORT_PATH = "telemetry.csv";
+
+/// Where the samples of a telemetry channel are read from
+enum class TelemetrySource {
+    /// Entry of the mjData::sensordata buffer
+    SENSOR,
+    /// Entry of the mjData::qpos buffer
+    QPOS,
+    /// Entry of the mjData::qvel buffer
+    QVEL,
+    /// Entry of the mjData::ctrl buffer
+    CTRL,
+    /// Entry of the mjData::act buffer
+    ACT,
+    /// Number of iterations used by the solver in the last step
+    SOLVER_ITER,
+    /// Number of detected contacts
+    NUM_CONTACTS,
+    /// Number of active constraints
+    NUM_CONSTRAINTS,
+    /// Potential energy (requires the energy flag enabled in the model)
+    ENERGY_POTENTIAL,
+    /// Kinetic energy (requires the energy flag enabled in the model)
+    ENERGY_KINETIC,
+};
+
+/// A single recorded scalar quantity
+struct TelemetryChannel {
+    /// Name of the channel (used for plots and exports)
+    std::string name;
+    /// Buffer from which the samples are read
+    TelemetrySource source = TelemetrySource::SENSOR;
+    /// Index into the source buffer (unused for scalar sources)
+    int index = 0;
+};
+
+/// Records a set of channels (sensors, joints, solver stats) every step into
+/// fixed-size ring buffers, stored as one contiguous array per channel. Each
+/// channel also keeps a min/max pyramid over its ring (updated in Record in
+/// O(log capacity)), so a decimated view costs O(bins * log window) rather
+/// than a scan over every sample of the window
+class Telemetry {
+ public:
+    /// Creates a recorder keeping the last capacity samples of each channel
+    /// (rounded up to a power of two)
+    explicit Telemetry(size_t capacity = TELEMETRY_DEFAULT_CAPACITY);
+
+    /// Adds a channel for every dimension of the given sensor
+    auto AddSensor(const mjModel& model, int sensor_id) -> void;
+
+    /// Adds channels for the position and velocity of the given (hinge or
+    /// slide) joint
+    auto AddJoint(const mjModel& model, int joint_id) -> void;
+
+    /// Adds channels for the solver statistics and the energy
+    auto AddSolverStats() -> void;
+
+    /// Adds a custom channel. Returns false (and doesn't add it) if its index
+    /// is out of range for its source buffer in the given model
+    auto AddChannel(const mjModel& model, TelemetryChannel channel) -> bool;
+
+    /// Removes all channels and recorded samples
+    auto ClearChannels() -> void;
+
+    /// Discards all recorded samples (keeps the channels)
+    auto Clear() -> void;
+
+    /// Records a sample of every channel from the given simulation
+    auto Record(const mjData& data) -> void;
+
+    /// Writes the recorded samples (oldest first) into a csv file
+    auto Export(const std::string& filepath) const -> bool;
+
+    /// Sets the file written when exporting from the ui
+    auto SetExportPath(std::string filepath) -> void {
+        m_ExportPath = std::move(filepath);
+    }
+
+    /// Returns the file written when exporting from the ui
+    auto GetExportPath() const -> const std::string& { return m_ExportPath; }
+
+    /// Computes a min/max envelope of the last num_samples samples of a
+    /// channel, using num_bins bins. Writes (min, max) pairs into envelope
+    /// (or the raw samples if there are fewer than 2 * num_bins of them), and
+    /// returns the number of values written
+    auto GetDecimated(size_t channel, size_t num_samples, int num_bins,
+                      std::vector<float>& envelope) const -> int;
+
+    /// Draws the plots of all channels (in the current ImGui window)
+    auto RenderUi() -> void;
+
+    /// Enables or disables the recording of samples
+    auto SetEnabled(bool enabled) -> void { m_Enabled = enabled; }
+
+    /// Returns whether or not samples are being recorded
+    auto IsEnabled() const -> bool { return m_Enabled; }
+
+    /// Returns the number of samples that can be kept per channel
+    auto GetCapacity() const -> size_t { return m_Capacity; }
+
+    /// Returns the number of samples currently stored per channel
+    auto GetNumSamples() const -> size_t { return m_NumSamples; }
+
+    /// Returns the channels recorded by this object
+    auto GetChannels() const -> const std::vector<TelemetryChannel>& {
+        return m_Channels;
+    }
+
+    /// Returns the i-th most recent sample of a channel (0 is the latest)
+    auto GetSample(size_t channel, size_t i) const -> float;
+
+ private:
+    /// Appends a channel (and its zeroed samples) without validation
+    auto _PushChannel(TelemetryChannel channel) -> void;
+
+    /// Refreshes the pyramid of a channel after writing the sample at slot
+    auto _UpdatePyramid(size_t channel, size_t slot) -> void;
+
+    /// Computes the min and max of a channel over the slots [begin, end) of
+    /// its ring (which must not wrap around)
+    auto _GetRange(size_t channel, size_t begin, size_t end, float& min_value,
+                   float& max_value) const -> void;
+
+ private:
+    /// Channels being recorded
+    std::vector<TelemetryChannel> m_Channels;
+    /// Samples of all channels (channel-major, each one a ring buffer)
+    std::vector<float> m_Values;
+    /// Min|max of aligned power-of-two blocks of each channel's ring (level k
+    /// covers blocks of 2^k slots; levels 1..log2(capacity) are packed into
+    /// capacity - 1 entries per channel)
+    std::vector<float> m_PyramidMin;
+    /// See m_PyramidMin
+    std::vector<float> m_PyramidMax;
+    /// Number of levels of the pyramids (log2 of the capacity)
+    size_t m_NumLevels = 0;
+    /// Simulation time of each sample
+    std::vector<double> m_Times;
+    /// Number of samples kept per channel (power of two)
+    size_t m_Capacity = 0;
+    /// Index of the slot where the next sample will be written
+    size_t m_Head = 0;
+    /// Number of samples currently stored
+    size_t m_NumSamples = 0;
+    /// Whether or not samples are being recorded
+    bool m_Enabled = true;
+    /// Number of samples shown in the plots
+    int m_PlotWindow = 0;
+    /// Scratch buffer used to store the decimated views while plotting
+    std::vector<float> m_PlotBuffer;
+    /// File written when exporting from the ui
+    std::string m_ExportPath = TELEMETRY_DEFAULT_EXPORT_PATH;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Fixed-size pool of worker threads consuming tasks from a shared queue
+class ThreadPool {
+ public:
+    /// Creates a pool with the given number of workers (0 means one per core)
+    explicit ThreadPool(size_t num_threads = 0);
+
+    /// Waits for the pending tasks and joins all workers
+    ~ThreadPool();
+
+    /// Not copy constructable
+    ThreadPool(const ThreadPool& rhs) = delete;
+
+    /// Not move constructable
+    ThreadPool(ThreadPool&& rhs) = delete;
+
+    /// No copy operations allowed
+    auto operator=(const ThreadPool& rhs) -> ThreadPool& = delete;
+
+    /// No move operations allowed
+    auto operator=(ThreadPool&& rhs) -> ThreadPool& = delete;
+
+    /// Adds a task to the queue, to be executed by any of the workers
+    auto Enqueue(std::function<void()> task) -> void;
+
+    /// Blocks until the queue is empty and all workers are idle
+    auto WaitIdle() -> void;
+
+    /// Runs func(i) for i in [0, count) split in contiguous chunks across the
+    /// workers, and blocks until all of them are done (don't call it from
+    /// within a task running on this same pool)
+    auto ParallelFor(int count, const std::function<void(int)>& func) -> void;
+
+    /// Returns the number of workers of this pool
+    auto GetNumThreads() const -> size_t { return m_Workers.size(); }
+
+ private:
+    /// Main loop run by each of the workers
+    auto _WorkerLoop() -> void;
+
+ private:
+    /// Threads owned by this pool
+    std::vector<std::thread> m_Workers;
+    /// Tasks waiting to be executed
+    std::deque<std::function<void()>> m_Tasks;
+    /// Mutex protecting the queue and the counters
+    std::mutex m_Mutex;
+    /// Signaled when a new task is added or the pool is stopping
+    std::condition_variable m_CondTasks;
+    /// Signaled when the pool becomes idle
+    std::condition_variable m_CondIdle;
+    /// Number of tasks currently being executed
+    size_t m_NumBusy = 0;
+    /// Whether or not the workers should exit
+    bool m_Stop = false;
+};
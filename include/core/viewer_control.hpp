@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/// Requests to attach|detach the viewer of a running simulation
+enum class ViewerCommand {
+    NONE,
+    ATTACH,
+    DETACH,
+};
+
+/// Listens for requests to attach|detach the viewer of a running simulation:
+///   * Signals: SIGUSR1 attaches the viewer, SIGUSR2 detaches it
+///   * Local socket: connect to the given unix-socket path and send either
+///     "attach" or "detach" (e.g. `echo attach | nc -U /tmp/sim.sock`)
+/// Requests are only recorded when received; Poll returns the latest one, so
+/// that the owner can act on it from its own (rendering) thread. Poll never
+/// blocks: partial commands are buffered per client until they're complete.
+/// Signal handlers are process-wide, so a single instance per process is
+/// supported (every instance would consume the same signal requests)
+class ViewerControl {
+ public:
+    /// Creates a listener (call InstallSignalHandlers|Listen to enable it)
+    ViewerControl() = default;
+
+    /// Closes and removes the socket (if any)
+    ~ViewerControl();
+
+    /// Not copy constructable
+    ViewerControl(const ViewerControl& rhs) = delete;
+
+    /// Not move constructable
+    ViewerControl(ViewerControl&& rhs) = delete;
+
+    /// No copy operations allowed
+    auto operator=(const ViewerControl& rhs) -> ViewerControl& = delete;
+
+    /// No move operations allowed
+    auto operator=(ViewerControl&& rhs) -> ViewerControl& = delete;
+
+    /// Installs handlers for SIGUSR1 (attach) and SIGUSR2 (detach). These
+    /// replace any previous handlers of the process
+    static auto InstallSignalHandlers() -> bool;
+
+    /// Starts listening for commands on a unix socket at the given path
+    auto Listen(const std::string& socket_path) -> bool;
+
+    /// Returns the latest request received since the last call (non-blocking)
+    auto Poll() -> ViewerCommand;
+
+ private:
+    /// A connected client that hasn't sent a full command yet
+    struct Client {
+        /// File descriptor of the connection
+        int fd = -1;
+        /// Bytes received so far
+        std::string buffer{};
+        /// Time after which the client is dropped
+        std::chrono::steady_clock::time_point deadline{};
+    };
+
+    /// Reads what's available from a client. Returns true once the client
+    /// is done (command received, closed, or timed out)
+    auto _ReadClient(Client& client, ViewerCommand& command) -> bool;
+
+ private:
+    /// File descriptor of the listening socket (-1 if not listening)
+    int m_SocketFd = -1;
+    /// Path of the listening socket
+    std::string m_SocketPath{};
+    /// Clients waiting to complete their command
+    std::vector<Client> m_Clients{};
+};
@@ -1,5 +1,7 @@
 #include <core/application.hpp>
+#include <algorithm>
 #include <iostream>
+#include <memory>
 
 #include "GLFW/glfw3.h"
 
@@ -9,68 +11,47 @@
 #include <backends/imgui_impl_opengl3.h>
 // clang-format on
 
-auto MjcModelDeleter::operator()(mjModel* ptr) const -> void {
-    if (ptr != nullptr) {
-        mj_deleteModel(ptr);
-    }
-}
+Application::Application(const char* app_name, const char* app_model,
+                         bool attach_viewer)
+    : m_Appname(app_name), m_Appmodel(app_model), m_ExitOnClose(attach_viewer) {
+    m_Modelpath = std::string(RESOURCES_PATH) + app_model;
+    LoadModel();
 
-auto MjcDataDeleter::operator()(mjData* ptr) const -> void {
-    if (ptr != nullptr) {
-        mj_deleteData(ptr);
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+    if (attach_viewer && !AttachViewer()) {
+        mju_error("Couldn't create the viewer for the application");
     }
+#endif
 }
 
-auto MjvSceneDeleter::operator()(mjvScene* ptr) const -> void {
-    if (ptr != nullptr) {
-        mjv_freeScene(ptr);
-    }
-}
+Application::~Application() { DetachViewer(); }
 
+auto Application::AttachViewer() -> bool {
 #ifndef MUJOCOEXT_BUILD_HEADLESS
-auto MjrContextDeleter::operator()(mjrContext* ptr) const -> void {
-    if (ptr != nullptr) {
-        mjr_freeContext(ptr);
+    if (m_Window != nullptr) {
+        return true;
     }
-}
-
-auto GLFWwindowDeleter::operator()(GLFWwindow* ptr) const -> void {
-    if (ptr != nullptr) {
-        glfwDestroyWindow(ptr);
-        glfwTerminate();
-    }
-}
-#endif
-
-Application::Application(const char* app_name, const char* app_model)
-    : m_Appname(app_name), m_Appmodel(app_model) {
-    m_Modelpath = std::string(RESOURCES_PATH) + app_model;
-    LoadModel();
 
-#ifndef MUJOCOEXT_BUILD_HEADLESS
     if (glfwInit() == GLFW_FALSE) {
-        mju_error("Couldn't initialize GLFW");
-        m_IsHeadless = true;
-        return;
+        std::cout << "Application >> couldn't initialize GLFW" << std::endl;
+        return false;
     }
 
     auto* glfw_window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT,
                                          m_Appname.c_str(), nullptr, nullptr);
     if (glfw_window == nullptr) {
-        mju_error("Couldn't create GLFW window");
-        m_IsHeadless = true;
+        std::cout << "Application >> couldn't create GLFW window" << std::endl;
+        glfwTerminate();
+        return false;
     }
     glfwMakeContextCurrent(glfw_window);
-    glfwSwapInterval(GLFW_TRUE);
+    glfwSwapInterval(m_ApplicationState.vsync ? GLFW_TRUE : GLFW_FALSE);
     // Keep ownership of this glfw window for later usage
     m_Window = std::unique_ptr<GLFWwindow, GLFWwindowDeleter>(glfw_window);
 
     // Initialize MuJoCo rendering context (we can do this step now that we
     // have a valid GLFW window and GL context properly setup)
-    m_Context =
-        std::unique_ptr<mjrContext, MjrContextDeleter>(new mjrContext());
-    mjr_defaultContext(m_Context.get());
-    mjr_makeContext(m_Model.get(), m_Context.get(), mjFONTSCALE_150);
+    _MakeContext();
 
     glfwSetWindowUserPointer(glfw_window, this);
 
@@ -78,11 +59,8 @@ Application::Application(const char* app_name, const char* app_model)
                                        int scancode, int action, int mode) {
         auto* application =
             static_cast<Application*>(glfwGetWindowUserPointer(window_ptr));
-        auto& mjc_model = application->model();
-        auto& mjc_data = application->data();
         if (action == GLFW_PRESS && key == GLFW_KEY_BACKSPACE) {
-            mj_resetData(&mjc_model, &mjc_data);
-            mj_forward(&mjc_model, &mjc_data);
+            application->Reset();
         }
         if (action == GLFW_PRESS && key == GLFW_KEY_ESCAPE) {
             glfwSetWindowShouldClose(window_ptr, GLFW_TRUE);
@@ -182,23 +160,62 @@ Application::Application(const char* app_name, const char* app_model)
     // Setup Platform/Renderer backends
     ImGui_ImplGlfw_InitForOpenGL(m_Window.get(), true);
     ImGui_ImplOpenGL3_Init("#version 130");
+
+    m_MouseState = MouseState{};
+    m_IsHeadless = false;
+    return true;
+#else
+    return false;
 #endif
 }
 
-Application::~Application() {
+auto Application::DetachViewer() -> void {
 #ifndef MUJOCOEXT_BUILD_HEADLESS
+    if (m_Window == nullptr) {
+        return;
+    }
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
+    // The rendering context has to be released while its GL context is alive
+    glfwMakeContextCurrent(m_Window.get());
+    m_Context = nullptr;
+    for (auto& [library_id, slot] : m_ModelSlots) {
+        slot.context = nullptr;
+    }
+    // Destroys the window and terminates GLFW
+    m_Window = nullptr;
+    m_MouseState = MouseState{};
+    m_ApplicationState.wants_to_capture_mouse = false;
+    m_IsHeadless = true;
 #endif
 }
 
+auto Application::EnableViewerControl(const char* socket_path) -> bool {
+    if (m_ViewerControl == nullptr) {
+        m_ViewerControl = std::make_unique<ViewerControl>();
+    }
+    bool success = ViewerControl::InstallSignalHandlers();
+    if (socket_path != nullptr) {
+        success = m_ViewerControl->Listen(socket_path) && success;
+    }
+    return success;
+}
+
 auto Application::Initialize() -> void {
     /// Call custom user-defined initialization routine
     _InitializeInternal();
 }
 
 auto Application::Step() -> void {
+    // Switching models doesn't advance the simulation, so it's also handled
+    // while paused
+    if (m_ApplicationState.requested_model >= 0) {
+        SwitchModel(m_ApplicationState.requested_model);
+        m_ApplicationState.requested_model = -1;
+        return;
+    }
+
     if (!m_ApplicationState.running) {
         return;
     }
@@ -220,23 +237,66 @@ auto Application::Step() -> void {
     while (m_Data->time - sim_start < 1.0 / SIMULATION_FPS) {
         // Apply controller and set control commands
         _SimStepInternal();
+        if (m_Controller != nullptr) {
+            m_Controller->Compute(*m_Model, *m_Data);
+        }
         // Take a step in the simulation
         mj_step(m_Model.get(), m_Data.get());
+        // Keep track of the history of the simulation
+        if (m_Telemetry != nullptr) {
+            m_Telemetry->Record(*m_Data);
+        }
+        if (m_DeterminismChecker != nullptr) {
+            m_DeterminismChecker->Record(*m_Model, *m_Data);
+        }
     }
 }
 
 auto Application::Render() -> void {
+    // Handle the requests to attach|detach the viewer
+    if (m_ViewerControl != nullptr) {
+        const auto command = m_ViewerControl->Poll();
+        if (command == ViewerCommand::ATTACH) {
+            AttachViewer();
+        } else if (command == ViewerCommand::DETACH) {
+            DetachViewer();
+        }
+    }
+
 #ifndef MUJOCOEXT_BUILD_HEADLESS
+    // Without a viewer there's nothing else to do (no scene updates nor UI)
+    if (m_Window == nullptr) {
+        return;
+    }
+
     // Process pending GUI events, call GLFW callbacks
     glfwPollEvents();
-#endif
+
+    // Closing the window only detaches the viewer if we started headless and
+    // it can be attached again (otherwise IsActive reports the close instead)
+    const bool close_requested = glfwWindowShouldClose(m_Window.get()) != 0;
+    const bool can_reattach = m_ViewerControl != nullptr;
+    auto& app_state = m_ApplicationState;
+    if (app_state.dirty_detach ||
+        (close_requested && !m_ExitOnClose && can_reattach)) {
+        app_state.dirty_detach = false;
+        DetachViewer();
+        return;
+    }
+
     // Update the abstract visualization scene (this is independent of wheter
     // or not we have a proper rendering context. We could sent draw calls even
     // remotely using RPC or similar protocol)
+    const int category_mask = m_Visibility.settings().category_mask;
     mjv_updateScene(m_Model.get(), m_Data.get(), &m_Option, nullptr, &m_Camera,
-                    mjCAT_ALL, m_Scene.get());
+                    category_mask, m_Scene.get());
+    if (m_Scene->ngeom >= m_Scene->maxgeom) {
+        // Geoms were dropped, so grow the scene and produce them again
+        SetSceneBudget(m_SceneBudget + m_Scene->maxgeom);
+        mjv_updateScene(m_Model.get(), m_Data.get(), &m_Option, nullptr,
+                        &m_Camera, category_mask, m_Scene.get());
+    }
 
-#ifndef MUJOCOEXT_BUILD_HEADLESS
     // Call user's custom render steps
     _RenderInternal();
 
@@ -262,8 +322,44 @@ auto Application::Render() -> void {
     // Prepare for the actual rendering
     mjrRect viewport = {0, 0, 0, 0};
     glfwGetFramebufferSize(m_Window.get(), &viewport.width, &viewport.height);
+    // Each view culls its own set of geoms, so keep the ones produced
+    const bool has_views =
+        std::any_of(m_Viewports.begin(), m_Viewports.end(),
+                    [](const Viewport& view) {
+                        return view.enabled && view.camera.fixedcamid >= 0;
+                    });
+    if (has_views) {
+        m_Visibility.Capture(*m_Scene);
+    }
     // Render the current scene
+    m_Visibility.Cull(*m_Scene, viewport);
     mjr_render(viewport, m_Scene.get(), m_Context.get());
+    // Render the additional views, reusing the geometry of the scene (only the
+    // camera-dependent part of the scene, i.e. the cameras and the lights that
+    // follow them like the headlight, has to be updated for each view)
+    for (auto& view : m_Viewports) {
+        if (!view.enabled || view.camera.fixedcamid < 0) {
+            continue;
+        }
+        const auto frame_width = static_cast<float>(viewport.width);
+        const auto frame_height = static_cast<float>(viewport.height);
+        mjrRect view_rect = {static_cast<int>(view.left * frame_width),
+                             static_cast<int>(view.bottom * frame_height),
+                             static_cast<int>(view.width * frame_width),
+                             static_cast<int>(view.height * frame_height)};
+        mjv_updateCamera(m_Model.get(), m_Data.get(), &view.camera,
+                         m_Scene.get());
+        mjv_makeLights(m_Model.get(), m_Data.get(), m_Scene.get());
+        m_Visibility.Cull(*m_Scene, view_rect);
+        mjr_render(view_rect, m_Scene.get(), m_Context.get());
+    }
+    if (has_views) {
+        // Restore the main camera (used to handle the mouse interaction)
+        mjv_updateCamera(m_Model.get(), m_Data.get(), &m_Camera,
+                         m_Scene.get());
+        mjv_makeLights(m_Model.get(), m_Data.get(), m_Scene.get());
+        m_Visibility.Release();
+    }
     // Render all ui-elements
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     // Swap buffers (blocking call due to v-sync)
@@ -272,7 +368,11 @@ auto Application::Render() -> void {
 }
 
 auto Application::LoadModel() -> void {
-    // Clear the previous simulation structures
+    // Clear the previous simulation structures (the model is reloaded from
+    // its file, even if it came from the library, so its layout may change)
+    _ReleaseModelBindings();
+    m_ActiveModel = -1;
+    m_ResetCache = nullptr;
     m_Model = nullptr;
     m_Data = nullptr;
     m_Scene = nullptr;
@@ -291,19 +391,185 @@ auto Application::LoadModel() -> void {
 
     auto* mjc_data = mj_makeData(mjc_model);
 
-    m_Model = std::unique_ptr<mjModel, MjcModelDeleter>(mjc_model);
-    m_Data = std::unique_ptr<mjData, MjcDataDeleter>(mjc_data);
-    m_Scene = std::unique_ptr<mjvScene, MjvSceneDeleter>(new mjvScene());
+    m_Model = std::shared_ptr<mjModel>(mjc_model, MjcModelDeleter());
+    m_Data = std::shared_ptr<mjData>(mjc_data, MjcDataDeleter());
+    m_ResetCache = _MakeResetCache(m_Model, -1);
 
     mjv_defaultCamera(&m_Camera);
     mjv_defaultOption(&m_Option);
-    mjv_defaultScene(m_Scene.get());
-    mjv_makeScene(mjc_model, m_Scene.get(), NUM_MAX_GEOMETRIES);
+    _MakeScene();
+
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+    // The rendering context holds model-specific resources (meshes, textures)
+    if (m_Context != nullptr) {
+        mjr_makeContext(mjc_model, m_Context.get(), mjFONTSCALE_150);
+    }
+#endif
+
+    _OnModelChanged();
+}
+
+auto Application::SetModelLibrary(std::shared_ptr<ModelLibrary> library)
+    -> void {
+    // The cached resources belong to the models of the previous library
+    if (library != m_Library) {
+        m_ModelSlots.clear();
+        m_ActiveModel = -1;
+    }
+    m_Library = std::move(library);
+}
+
+auto Application::SwitchModel(int library_id) -> bool {
+    if (m_Library == nullptr ||
+        m_Library->GetStatus(library_id) != ModelStatus::READY) {
+        std::cout << "Application >> model " << library_id
+                  << " isn't ready in the model library" << std::endl;
+        return false;
+    }
+    if (library_id == m_ActiveModel) {
+        return true;
+    }
+    _ReleaseModelBindings();
+
+    // Keep the resources of the current model around, if it came from the
+    // library (a model loaded from file is just released)
+    if (m_ActiveModel >= 0) {
+        auto& current = m_ModelSlots[m_ActiveModel];
+        current.scene = std::move(m_Scene);
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+        current.context = std::move(m_Context);
+#endif
+    }
+
+    auto& slot = m_ModelSlots[library_id];
+    if (slot.model == nullptr) {
+        slot.model = m_Library->GetModel(library_id);
+        slot.data = m_Library->Acquire(library_id);
+    }
+    // Dropped when the reset keyframe changes while the model isn't active
+    if (slot.reset_cache == nullptr) {
+        slot.reset_cache = _MakeResetCache(slot.model, library_id);
+    }
+    m_Model = slot.model;
+    m_Data = slot.data;
+    m_ResetCache = slot.reset_cache;
+    m_ActiveModel = library_id;
+    m_Appmodel = m_Library->GetName(library_id);
+    m_Modelpath = m_Library->GetPath(library_id);
+
+    // Only the first switch to a model creates its scene and context
+    m_Scene = std::move(slot.scene);
+    if (m_Scene == nullptr) {
+        _MakeScene();
+    }
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+    m_Context = std::move(slot.context);
+    if (m_Window != nullptr && m_Context == nullptr) {
+        _MakeContext();
+    }
+#endif
+
+    _OnModelChanged();
+    return true;
+}
+
+auto Application::_OnModelChanged() -> void {
+    // The ids of the cameras might have changed after a reload|switch
+    for (auto& view : m_Viewports) {
+        view.camera.fixedcamid = mj_name2id(m_Model.get(), mjOBJ_CAMERA,
+                                            view.camera_name.c_str());
+    }
 
     // Call user-defined reload logic
     _ReloadInternal();
 }
 
+auto Application::SetResetKeyframe(int key_id) -> void {
+    m_ResetKeyframe = std::max(key_id, -1);
+    for (auto& [library_id, slot] : m_ModelSlots) {
+        slot.reset_cache = nullptr;
+    }
+    if (m_Model == nullptr) {
+        return;
+    }
+    m_ResetCache = _MakeResetCache(m_Model, m_ActiveModel);
+    if (m_ActiveModel >= 0) {
+        m_ModelSlots[m_ActiveModel].reset_cache = m_ResetCache;
+    }
+}
+
+auto Application::_MakeResetCache(const std::shared_ptr<mjModel>& model,
+                                  int library_id)
+    -> std::shared_ptr<ResetCache> {
+    // The library only keeps snapshots of the default state
+    if (library_id >= 0 && m_ResetKeyframe < 0) {
+        return m_Library->GetResetCache(library_id);
+    }
+    return std::make_shared<ResetCache>(*model, m_ResetKeyframe);
+}
+
+auto Application::_ReleaseModelBindings() -> void {
+    // Channels, hashes and controls are laid out after the previous model
+    if (m_Telemetry != nullptr) {
+        m_Telemetry->ClearChannels();
+    }
+    if (m_DeterminismChecker != nullptr) {
+        m_DeterminismChecker->Clear();
+    }
+    if (m_Controller != nullptr) {
+        std::cout << "Application >> released the controller of the "
+                     "previous model"
+                  << std::endl;
+        m_Controller = nullptr;
+    }
+}
+
+auto Application::SetSceneBudget(int budget) -> void {
+    m_SceneBudget = std::max(budget, 0);
+    if (m_Model != nullptr) {
+        _MakeScene();
+    }
+}
+
+auto Application::_MakeScene() -> void {
+    // Size the scene after the model, instead of a fixed number of geoms
+    m_Scene = std::unique_ptr<mjvScene, MjvSceneDeleter>(new mjvScene());
+    mjv_defaultScene(m_Scene.get());
+    mjv_makeScene(m_Model.get(), m_Scene.get(),
+                  SceneVisibility::ComputeCapacity(*m_Model, m_SceneBudget));
+}
+
+auto Application::_MakeContext() -> void {
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+    m_Context =
+        std::unique_ptr<mjrContext, MjrContextDeleter>(new mjrContext());
+    mjr_defaultContext(m_Context.get());
+    mjr_makeContext(m_Model.get(), m_Context.get(), mjFONTSCALE_150);
+#endif
+}
+
+auto Application::AddViewport(const char* camera_name, float left,
+                              float bottom, float width, float height) -> int {
+    const int camera_id = mj_name2id(m_Model.get(), mjOBJ_CAMERA, camera_name);
+    if (camera_id < 0) {
+        std::cout << "Application >> there's no camera named [" << camera_name
+                  << "] in model [" << m_Modelpath << "]" << std::endl;
+        return -1;
+    }
+
+    Viewport view;
+    view.camera_name = camera_name;
+    mjv_defaultCamera(&view.camera);
+    view.camera.type = mjCAMERA_FIXED;
+    view.camera.fixedcamid = camera_id;
+    view.left = left;
+    view.bottom = bottom;
+    view.width = width;
+    view.height = height;
+    m_Viewports.push_back(view);
+    return static_cast<int>(m_Viewports.size()) - 1;
+}
+
 auto Application::_RenderUiCore() -> void {
     auto& app_state = m_ApplicationState;
     // --------------------------------
@@ -317,6 +583,28 @@ auto Application::_RenderUiCore() -> void {
         if (ImGui::Button("Reload")) {
             app_state.dirty_reload = true;
         }
+        // Switch between the preloaded models (the switch happens on Step)
+        if (m_Library != nullptr &&
+            ImGui::BeginCombo("Model", m_Appmodel.c_str())) {
+            for (int id = 0; id < m_Library->GetNumModels(); ++id) {
+                const auto status = m_Library->GetStatus(id);
+                auto label = m_Library->GetName(id);
+                if (status == ModelStatus::PENDING) {
+                    label += " (compiling)";
+                } else if (status == ModelStatus::FAILED) {
+                    label += " (failed)";
+                }
+                const bool is_active = id == m_ActiveModel;
+                if (ImGui::Selectable(label.c_str(), is_active) &&
+                    status == ModelStatus::READY) {
+                    app_state.requested_model = id;
+                }
+                if (is_active) {
+                    ImGui::SetItemDefaultFocus();
+                }
+            }
+            ImGui::EndCombo();
+        }
     }
     if (ImGui::CollapsingHeader("Rendering")) {
         // Check vsync property
@@ -325,17 +613,43 @@ auto Application::_RenderUiCore() -> void {
         if (old_vsync != app_state.vsync) {
             glfwSwapInterval(app_state.vsync ? GLFW_TRUE : GLFW_FALSE);
         }
+        // Without viewer control there'd be no way to attach it back
+        if (m_ViewerControl != nullptr && ImGui::Button("Detach viewer")) {
+            app_state.dirty_detach = true;
+        }
+    }
+    if (!m_Viewports.empty() && ImGui::CollapsingHeader("Viewports")) {
+        // Several views can use the same camera, so make their ids unique
+        for (size_t i = 0; i < m_Viewports.size(); ++i) {
+            auto& view = m_Viewports[i];
+            const auto label = view.camera_name + "##" + std::to_string(i);
+            ImGui::Checkbox(label.c_str(), &view.enabled);
+        }
+    }
+    if (ImGui::CollapsingHeader("Visibility")) {
+        m_Visibility.RenderUi(m_Option);
+        ImGui::Text("Scene capacity: %d geoms", m_Scene->maxgeom);
+    }
+    if (m_Telemetry != nullptr && ImGui::CollapsingHeader("Telemetry")) {
+        m_Telemetry->RenderUi();
     }
     ImGui::End();
 }
 
 auto Application::Reset() -> void {
-    mj_resetData(m_Model.get(), m_Data.get());
-    mj_forward(m_Model.get(), m_Data.get());
+    // Restore from the forwarded initial state (avoids a full mj_forward)
+    m_ResetCache->Restore(*m_Data);
 }
 
 auto Application::IsActive() const -> bool {
 #ifndef MUJOCOEXT_BUILD_HEADLESS
+    if (m_Window == nullptr) {
+        return true;
+    }
+    // Windows that can be attached again are detached when closed instead
+    if (!m_ExitOnClose && m_ViewerControl != nullptr) {
+        return true;
+    }
     return !static_cast<bool>(glfwWindowShouldClose(m_Window.get()));
 #else
     return true;
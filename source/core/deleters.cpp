@@ -0,0 +1,38 @@
+#include <core/deleters.hpp>
+
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+#include <GLFW/glfw3.h>
+#endif
+
+auto MjcModelDeleter::operator()(mjModel* ptr) const -> void {
+    if (ptr != nullptr) {
+        mj_deleteModel(ptr);
+    }
+}
+
+auto MjcDataDeleter::operator()(mjData* ptr) const -> void {
+    if (ptr != nullptr) {
+        mj_deleteData(ptr);
+    }
+}
+
+auto MjvSceneDeleter::operator()(mjvScene* ptr) const -> void {
+    if (ptr != nullptr) {
+        mjv_freeScene(ptr);
+    }
+}
+
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+auto MjrContextDeleter::operator()(mjrContext* ptr) const -> void {
+    if (ptr != nullptr) {
+        mjr_freeContext(ptr);
+    }
+}
+
+auto GLFWwindowDeleter::operator()(GLFWwindow* ptr) const -> void {
+    if (ptr != nullptr) {
+        glfwDestroyWindow(ptr);
+        glfwTerminate();
+    }
+}
+#endif
@@ -0,0 +1,340 @@
+#include <core/determinism_checker.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr uint32_t PRIME32_1 = 0x9E3779B1U;
+constexpr uint32_t PRIME32_2 = 0x85EBCA77U;
+constexpr uint32_t PRIME32_3 = 0xC2B2AE3DU;
+constexpr uint32_t PRIME32_4 = 0x27D4EB2FU;
+constexpr uint32_t PRIME32_5 = 0x165667B1U;
+/// Number of independent lanes (32-bit words consumed per round)
+constexpr size_t NUM_LANES = 8;
+/// Amount each lane is rotated by per round
+constexpr uint32_t ROUND_ROTATION = 13;
+
+inline auto Rotl(uint32_t value, uint32_t amount) -> uint32_t {
+    return (value << amount) | (value >> (32U - amount));
+}
+
+inline auto Round(uint32_t acc, uint32_t input) -> uint32_t {
+    return Rotl(acc + input * PRIME32_2, ROUND_ROTATION) * PRIME32_1;
+}
+
+/// Consumes num_stripes stripes of NUM_LANES words into the lanes
+auto ConsumeStripes(uint32_t* lanes, const uint8_t* input, size_t num_stripes)
+    -> void {
+#if defined(__AVX2__)
+    __m256i v_acc = _mm256_loadu_si256(reinterpret_cast<__m256i*>(lanes));
+    const __m256i v_prime1 = _mm256_set1_epi32(static_cast<int>(PRIME32_1));
+    const __m256i v_prime2 = _mm256_set1_epi32(static_cast<int>(PRIME32_2));
+    for (size_t s = 0; s < num_stripes; ++s) {
+        const __m256i v_input = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(input + s * NUM_LANES * 4));
+        v_acc = _mm256_add_epi32(v_acc, _mm256_mullo_epi32(v_input, v_prime2));
+        v_acc = _mm256_or_si256(_mm256_slli_epi32(v_acc, ROUND_ROTATION),
+                                _mm256_srli_epi32(v_acc, 32 - ROUND_ROTATION));
+        v_acc = _mm256_mullo_epi32(v_acc, v_prime1);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), v_acc);
+#elif defined(__ARM_NEON)
+    uint32x4_t v_acc_lo = vld1q_u32(lanes);
+    uint32x4_t v_acc_hi = vld1q_u32(lanes + 4);
+    for (size_t s = 0; s < num_stripes; ++s) {
+        const auto* stripe = input + s * NUM_LANES * 4;
+        const uint32x4_t v_in_lo = vreinterpretq_u32_u8(vld1q_u8(stripe));
+        const uint32x4_t v_in_hi = vreinterpretq_u32_u8(vld1q_u8(stripe + 16));
+        v_acc_lo = vmlaq_n_u32(v_acc_lo, v_in_lo, PRIME32_2);
+        v_acc_hi = vmlaq_n_u32(v_acc_hi, v_in_hi, PRIME32_2);
+        v_acc_lo = vorrq_u32(vshlq_n_u32(v_acc_lo, ROUND_ROTATION),
+                             vshrq_n_u32(v_acc_lo, 32 - ROUND_ROTATION));
+        v_acc_hi = vorrq_u32(vshlq_n_u32(v_acc_hi, ROUND_ROTATION),
+                             vshrq_n_u32(v_acc_hi, 32 - ROUND_ROTATION));
+        v_acc_lo = vmulq_n_u32(v_acc_lo, PRIME32_1);
+        v_acc_hi = vmulq_n_u32(v_acc_hi, PRIME32_1);
+    }
+    vst1q_u32(lanes, v_acc_lo);
+    vst1q_u32(lanes + 4, v_acc_hi);
+#else
+    for (size_t s = 0; s < num_stripes; ++s) {
+        for (size_t l = 0; l < NUM_LANES; ++l) {
+            uint32_t word = 0;
+            std::memcpy(&word, input + (s * NUM_LANES + l) * 4, sizeof(word));
+            lanes[l] = Round(lanes[l], word);  // NOLINT
+        }
+    }
+#endif
+}
+
+/// Fills the per-array flags of the report for a single step, and returns
+/// whether or not the two hashes differ
+auto CompareStep(const StateHash& lhs, const StateHash& rhs,
+                 DivergenceReport& report) -> bool {
+    report.time_differs =
+        std::memcmp(&lhs.time, &rhs.time, sizeof(double)) != 0;
+    report.qpos_differs = lhs.qpos != rhs.qpos;
+    report.qvel_differs = lhs.qvel != rhs.qvel;
+    report.act_differs = lhs.act != rhs.act;
+    report.warmstart_differs = lhs.warmstart != rhs.warmstart;
+    return report.time_differs || report.qpos_differs ||
+           report.qvel_differs || report.act_differs ||
+           report.warmstart_differs;
+}
+
+/// Compares two streams that keep the steps [first, total) of their runs,
+/// over the steps both of them kept
+auto CompareStreams(const std::vector<StateHash>& stream, size_t stream_first,
+                    size_t stream_total,
+                    const std::vector<StateHash>& reference,
+                    size_t reference_first, size_t reference_total)
+    -> DivergenceReport {
+    DivergenceReport report;
+    const auto first = std::max(stream_first, reference_first);
+    const auto last = std::min(stream_total, reference_total);
+    for (size_t step = first; step < last; ++step) {
+        const auto& lhs = stream[step - stream_first];
+        if (CompareStep(lhs, reference[step - reference_first], report)) {
+            report.diverged = true;
+            report.step = static_cast<long>(step);  // NOLINT
+            report.time = lhs.time;
+            return report;
+        }
+    }
+    if (stream_total != reference_total) {
+        report.diverged = true;
+        report.length_differs = true;
+        report.step = static_cast<long>(last);  // NOLINT
+    }
+    return report;
+}
+
+}  // namespace
+
+auto HashBuffer(const void* buffer, size_t num_bytes, uint32_t seed)
+    -> uint32_t {
+    const auto* input = static_cast<const uint8_t*>(buffer);
+    uint32_t lanes[NUM_LANES];  // NOLINT
+    for (size_t l = 0; l < NUM_LANES; ++l) {
+        lanes[l] = seed + PRIME32_1 * static_cast<uint32_t>(l + 1);  // NOLINT
+    }
+
+    const size_t stripe_size = NUM_LANES * sizeof(uint32_t);
+    const size_t num_stripes = num_bytes / stripe_size;
+    ConsumeStripes(lanes, input, num_stripes);
+
+    // Merge the lanes, then consume the remaining words and bytes
+    uint32_t hash = static_cast<uint32_t>(num_bytes);
+    for (size_t l = 0; l < NUM_LANES; ++l) {
+        hash += Rotl(lanes[l], static_cast<uint32_t>(l + 1));  // NOLINT
+    }
+    size_t offset = num_stripes * stripe_size;
+    for (; offset + 4 <= num_bytes; offset += 4) {
+        uint32_t word = 0;
+        std::memcpy(&word, input + offset, sizeof(word));
+        hash = Rotl(hash + word * PRIME32_3, 17) * PRIME32_4;  // NOLINT
+    }
+    for (; offset < num_bytes; ++offset) {
+        hash += static_cast<uint32_t>(input[offset]) * PRIME32_5;
+        hash = Rotl(hash, 11) * PRIME32_1;  // NOLINT
+    }
+
+    // Final avalanche
+    hash ^= hash >> 15U;  // NOLINT
+    hash *= PRIME32_2;
+    hash ^= hash >> 13U;  // NOLINT
+    hash *= PRIME32_3;
+    hash ^= hash >> 16U;  // NOLINT
+    return hash;
+}
+
+auto DivergenceReport::ToString() const -> std::string {
+    if (!diverged) {
+        return "no divergence";
+    }
+    std::stringstream msg;
+    if (!time_differs && !qpos_differs && !qvel_differs && !act_differs &&
+        !warmstart_differs && length_differs) {
+        msg << "streams have different lengths (identical for the first "
+            << step << " steps)";
+        return msg.str();
+    }
+    msg << "diverged at step " << step << " (time " << time << "):";
+    msg << (time_differs ? " time" : "") << (qpos_differs ? " qpos" : "")
+        << (qvel_differs ? " qvel" : "") << (act_differs ? " act" : "")
+        << (warmstart_differs ? " qacc_warmstart" : "");
+    return msg.str();
+}
+
+auto DeterminismChecker::Hash(const mjModel& model, const mjData& data)
+    -> StateHash {
+    const auto nq = static_cast<size_t>(model.nq);
+    const auto nv = static_cast<size_t>(model.nv);
+    const auto na = static_cast<size_t>(model.na);
+    StateHash state_hash;
+    state_hash.time = data.time;
+    state_hash.qpos = HashBuffer(data.qpos, nq * sizeof(mjtNum));
+    state_hash.qvel = HashBuffer(data.qvel, nv * sizeof(mjtNum));
+    state_hash.act = HashBuffer(data.act, na * sizeof(mjtNum));
+    state_hash.warmstart = HashBuffer(data.qacc_warmstart, nv * sizeof(mjtNum));
+    return state_hash;
+}
+
+auto DeterminismChecker::Record(const mjModel& model, const mjData& data)
+    -> void {
+    if (m_Capacity > 0 && m_Stream.size() >= m_Capacity) {
+        // Drop the oldest half at once, so trimming is amortized O(1)
+        const auto num_dropped = m_Stream.size() - m_Capacity / 2;
+        m_Stream.erase(m_Stream.begin(),
+                       m_Stream.begin() + static_cast<long>(num_dropped));
+        m_FirstStep += num_dropped;
+    }
+    m_Stream.push_back(Hash(model, data));
+    const auto step = m_NumSteps++;
+    if (m_Report.diverged || step < m_ReferenceFirst ||
+        step - m_ReferenceFirst >= m_Reference.size()) {
+        return;
+    }
+
+    const auto& expected = m_Reference[step - m_ReferenceFirst];
+    if (CompareStep(m_Stream.back(), expected, m_Report)) {
+        m_Report.diverged = true;
+        m_Report.step = static_cast<long>(step);  // NOLINT
+        m_Report.time = m_Stream.back().time;
+        std::cout << "DeterminismChecker >> " << m_Report.ToString()
+                  << std::endl;
+    }
+}
+
+auto DeterminismChecker::Compare(const std::vector<StateHash>& stream,
+                                 const std::vector<StateHash>& reference)
+    -> DivergenceReport {
+    return CompareStreams(stream, 0, stream.size(), reference, 0,
+                          reference.size());
+}
+
+auto DeterminismChecker::Compare(const DeterminismChecker& reference) const
+    -> DivergenceReport {
+    return CompareStreams(m_Stream, m_FirstStep, m_NumSteps,
+                          reference.m_Stream, reference.m_FirstStep,
+                          reference.m_NumSteps);
+}
+
+auto DeterminismChecker::SetReference(std::vector<StateHash> reference,
+                                      size_t first_step) -> void {
+    m_Reference = std::move(reference);
+    m_ReferenceFirst = first_step;
+    m_Report = DivergenceReport{};
+}
+
+auto DeterminismChecker::LoadReference(const std::string& filepath) -> bool {
+    std::vector<StateHash> reference;
+    size_t first_step = 0;
+    if (!LoadStream(filepath, reference, first_step)) {
+        return false;
+    }
+    SetReference(std::move(reference), first_step);
+    return true;
+}
+
+auto DeterminismChecker::Save(const std::string& filepath) const -> bool {
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "DeterminismChecker >> couldn't open file [" << filepath
+                  << "] for writing" << std::endl;
+        return false;
+    }
+    const uint64_t first_step = m_FirstStep;
+    const uint64_t num_steps = m_Stream.size();
+    file.write(reinterpret_cast<const char*>(&DETERMINISM_MAGIC),  // NOLINT
+               sizeof(DETERMINISM_MAGIC));
+    file.write(reinterpret_cast<const char*>(&first_step),  // NOLINT
+               sizeof(first_step));
+    file.write(reinterpret_cast<const char*>(&num_steps),  // NOLINT
+               sizeof(num_steps));
+    for (const auto& state_hash : m_Stream) {
+        file.write(reinterpret_cast<const char*>(&state_hash.time),  // NOLINT
+                   sizeof(state_hash.time));
+        const uint32_t hashes[4] = {state_hash.qpos, state_hash.qvel,  // NOLINT
+                                    state_hash.act, state_hash.warmstart};
+        file.write(reinterpret_cast<const char*>(hashes),  // NOLINT
+                   sizeof(hashes));
+    }
+    return static_cast<bool>(file);
+}
+
+auto DeterminismChecker::LoadStream(const std::string& filepath,
+                                    std::vector<StateHash>& stream) -> bool {
+    size_t first_step = 0;
+    if (!LoadStream(filepath, stream, first_step)) {
+        return false;
+    }
+    if (first_step > 0) {
+        std::cout << "DeterminismChecker >> hash-stream file [" << filepath
+                  << "] starts at step " << first_step << ", not at step 0"
+                  << std::endl;
+        stream.clear();
+        return false;
+    }
+    return true;
+}
+
+auto DeterminismChecker::LoadStream(const std::string& filepath,
+                                    std::vector<StateHash>& stream,
+                                    size_t& first_step) -> bool {
+    std::ifstream file(filepath, std::ios::binary);
+    uint32_t magic = 0;
+    uint64_t first = 0;
+    uint64_t num_steps = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));  // NOLINT
+    if (magic == DETERMINISM_MAGIC) {
+        file.read(reinterpret_cast<char*>(&first), sizeof(first));  // NOLINT
+    }
+    file.read(reinterpret_cast<char*>(&num_steps),  // NOLINT
+              sizeof(num_steps));
+    if (!file ||
+        (magic != DETERMINISM_MAGIC && magic != DETERMINISM_MAGIC_V0)) {
+        std::cout << "DeterminismChecker >> invalid hash-stream file ["
+                  << filepath << "]" << std::endl;
+        return false;
+    }
+
+    stream.clear();
+    for (uint64_t i = 0; i < num_steps; ++i) {
+        StateHash state_hash;
+        uint32_t hashes[4] = {0, 0, 0, 0};  // NOLINT
+        file.read(reinterpret_cast<char*>(&state_hash.time),  // NOLINT
+                  sizeof(state_hash.time));
+        file.read(reinterpret_cast<char*>(hashes), sizeof(hashes));  // NOLINT
+        if (!file) {
+            std::cout << "DeterminismChecker >> hash-stream file [" << filepath
+                      << "] ended before all steps were read" << std::endl;
+            return false;
+        }
+        state_hash.qpos = hashes[0];
+        state_hash.qvel = hashes[1];
+        state_hash.act = hashes[2];
+        state_hash.warmstart = hashes[3];
+        stream.push_back(state_hash);
+    }
+    first_step = static_cast<size_t>(first);
+    return true;
+}
+
+auto DeterminismChecker::Clear() -> void {
+    m_Stream.clear();
+    m_FirstStep = 0;
+    m_NumSteps = 0;
+    m_Report = DivergenceReport{};
+}
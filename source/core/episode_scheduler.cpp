@@ -0,0 +1,223 @@
+#include <core/episode_scheduler.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+auto EpisodeTask::promise_type::FinalAwaiter::await_suspend(
+    std::coroutine_handle<promise_type> handle) noexcept -> void {
+    handle.promise().episode->scheduler()._OnEpisodeLoopDone();
+}
+
+EpisodeTask::~EpisodeTask() {
+    if (m_Handle) {
+        m_Handle.destroy();
+    }
+}
+
+auto EpisodeTask::operator=(EpisodeTask&& rhs) noexcept -> EpisodeTask& {
+    if (this != &rhs) {
+        if (m_Handle) {
+            m_Handle.destroy();
+        }
+        m_Handle = std::exchange(rhs.m_Handle, nullptr);
+    }
+    return *this;
+}
+
+auto ActionAwaiter::await_suspend(std::coroutine_handle<> handle) const
+    -> void {
+    // The awaiter lives in the coroutine frame, which might be resumed by
+    // another worker as soon as the request is registered (don't touch it)
+    auto* requester = episode;
+    requester->scheduler()._OnActionRequest(requester, handle);
+}
+
+Episode::Episode(EpisodeScheduler& scheduler, const mjModel& model, int id)
+    : m_Scheduler(scheduler), m_Model(model), m_Id(id) {
+    m_Data = std::unique_ptr<mjData, MjcDataDeleter>(mj_makeData(&m_Model));
+    if (m_Scheduler.GetSettings().check_determinism) {
+        m_DeterminismChecker = std::make_unique<DeterminismChecker>();
+    }
+}
+
+auto Episode::Step() -> void {
+    const auto num_substeps = m_Scheduler.GetSettings().num_substeps;
+    for (int i = 0; i < num_substeps; ++i) {
+        mj_step(&m_Model, m_Data.get());
+        if (m_DeterminismChecker != nullptr) {
+            m_DeterminismChecker->Record(m_Model, *m_Data);
+        }
+    }
+    ++m_EpisodeSteps;
+    ++m_TotalSteps;
+}
+
+auto Episode::Reset() -> void {
+    m_Scheduler.GetResetCache().Restore(*m_Data, m_Id);
+    m_EpisodeSteps = 0;
+    ++m_NumEpisodes;
+}
+
+auto Episode::IsTerminated() const -> bool {
+    if (m_EpisodeSteps >= m_Scheduler.GetSettings().max_episode_steps) {
+        return true;
+    }
+    const auto& termination_fn = m_Scheduler.GetTerminationFn();
+    return termination_fn && termination_fn(m_Model, *m_Data);
+}
+
+EpisodeScheduler::EpisodeScheduler(const mjModel& model,
+                                   std::shared_ptr<Controller> controller,
+                                   const EpisodeSchedulerSettings& settings)
+    : m_Model(model),
+      m_Controller(std::move(controller)),
+      m_Settings(settings) {
+    m_Settings.num_envs = std::max(1, m_Settings.num_envs);
+    m_Settings.batch_size = std::max(1, m_Settings.batch_size);
+    m_Settings.num_substeps = std::max(1, m_Settings.num_substeps);
+    if (m_Settings.check_determinism && m_Settings.num_substeps > 1) {
+        std::cout << "EpisodeScheduler >> with num_substeps > 1 the hash "
+                     "streams can only be compared against other schedulers "
+                     "(the serial path runs the controller every mj_step)"
+                  << std::endl;
+    }
+    m_ResetCache = std::make_unique<ResetCache>(m_Model);
+    m_Episodes.reserve(static_cast<size_t>(m_Settings.num_envs));
+    for (int i = 0; i < m_Settings.num_envs; ++i) {
+        m_Episodes.push_back(std::make_unique<Episode>(*this, m_Model, i));
+    }
+    m_Pool = std::make_unique<ThreadPool>(
+        static_cast<size_t>(std::max(0, m_Settings.num_workers)));
+    m_PendingEpisodes.reserve(m_Episodes.size());
+    m_PendingHandles.reserve(m_Episodes.size());
+}
+
+auto EpisodeScheduler::Run(const EpisodeFn& episode_fn) -> void {
+    std::vector<EpisodeTask> tasks;
+    tasks.reserve(m_Episodes.size());
+    for (auto& episode : m_Episodes) {
+        tasks.push_back(episode_fn(*episode));
+        tasks.back().handle().promise().episode = episode.get();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_NumActive = static_cast<int>(tasks.size());
+        m_NumAlive = static_cast<int>(tasks.size());
+        m_NumBatches = 0;
+        m_NumActions = 0;
+    }
+    for (auto& task : tasks) {
+        auto handle = task.handle();
+        m_Pool->Enqueue([handle]() { handle.resume(); });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_CondDone.wait(lock, [this]() { return m_NumAlive == 0; });
+    }
+    // Make sure no worker is still inside a coroutine before destroying them
+    m_Pool->WaitIdle();
+}
+
+auto EpisodeScheduler::Run(int num_episodes) -> void {
+    Run([num_episodes](Episode& episode) {
+        return EpisodeLoop(episode, num_episodes);
+    });
+}
+
+auto EpisodeScheduler::EpisodeLoop(Episode& episode, int num_episodes)
+    -> EpisodeTask {
+    for (int i = 0; i < num_episodes; ++i) {
+        episode.Reset();
+        while (!episode.IsTerminated()) {
+            co_await episode.RequestAction();
+            episode.Step();
+        }
+    }
+}
+
+auto EpisodeScheduler::_OnActionRequest(Episode* episode,
+                                        std::coroutine_handle<> handle)
+    -> void {
+    std::vector<Episode*> batch_episodes;
+    std::vector<std::coroutine_handle<>> batch_handles;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_PendingEpisodes.push_back(episode);
+        m_PendingHandles.push_back(handle);
+        --m_NumActive;
+        if (!_TryTakeBatch(batch_episodes, batch_handles)) {
+            return;
+        }
+    }
+    m_Pool->Enqueue([this, batch_episodes = std::move(batch_episodes),
+                     batch_handles = std::move(batch_handles)]() mutable {
+        _DispatchBatch(std::move(batch_episodes), std::move(batch_handles));
+    });
+}
+
+auto EpisodeScheduler::_OnEpisodeLoopDone() -> void {
+    std::vector<Episode*> batch_episodes;
+    std::vector<std::coroutine_handle<>> batch_handles;
+    bool has_batch = false;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        --m_NumActive;
+        --m_NumAlive;
+        if (m_NumAlive == 0) {
+            m_CondDone.notify_all();
+            return;
+        }
+        has_batch = _TryTakeBatch(batch_episodes, batch_handles);
+    }
+    if (has_batch) {
+        m_Pool->Enqueue([this, batch_episodes = std::move(batch_episodes),
+                         batch_handles = std::move(batch_handles)]() mutable {
+            _DispatchBatch(std::move(batch_episodes),
+                           std::move(batch_handles));
+        });
+    }
+}
+
+auto EpisodeScheduler::_TryTakeBatch(
+    std::vector<Episode*>& episodes,
+    std::vector<std::coroutine_handle<>>& handles) -> bool {
+    const auto batch_size = static_cast<size_t>(m_Settings.batch_size);
+    // Send the batch once it's full, or if nothing else can add to it
+    if (m_PendingEpisodes.empty() ||
+        (m_PendingEpisodes.size() < batch_size && m_NumActive > 0)) {
+        return false;
+    }
+    const auto num_taken = std::min(batch_size, m_PendingEpisodes.size());
+    const auto offset = static_cast<std::ptrdiff_t>(num_taken);
+    episodes.assign(m_PendingEpisodes.begin(),
+                    m_PendingEpisodes.begin() + offset);
+    handles.assign(m_PendingHandles.begin(), m_PendingHandles.begin() + offset);
+    m_PendingEpisodes.erase(m_PendingEpisodes.begin(),
+                            m_PendingEpisodes.begin() + offset);
+    m_PendingHandles.erase(m_PendingHandles.begin(),
+                           m_PendingHandles.begin() + offset);
+    // These loops are active again (evaluating, then queued to resume)
+    m_NumActive += static_cast<int>(num_taken);
+    ++m_NumBatches;
+    m_NumActions += static_cast<long>(num_taken);  // NOLINT
+    return true;
+}
+
+auto EpisodeScheduler::_DispatchBatch(
+    std::vector<Episode*> episodes,
+    std::vector<std::coroutine_handle<>> handles) -> void {
+    if (m_Controller != nullptr) {
+        std::vector<mjData*> data_batch(episodes.size());
+        std::transform(episodes.begin(), episodes.end(), data_batch.begin(),
+                       [](Episode* episode) { return &episode->data(); });
+        std::lock_guard<std::mutex> lock(m_ControllerMutex);
+        m_Controller->ComputeBatch(m_Model, data_batch.data(),
+                                   static_cast<int>(data_batch.size()));
+    }
+    for (auto handle : handles) {
+        m_Pool->Enqueue([handle]() { handle.resume(); });
+    }
+}
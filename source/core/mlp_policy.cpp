@@ -0,0 +1,265 @@
+#include <core/mlp_policy.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+// The same backend is used by all kernels (and reported by GetSimdBackend).
+// MSVC doesn't define __FMA__, but /arch:AVX2 also enables FMA instructions
+#if defined(__AVX512F__)
+#define MUJOCOEXT_MLP_AVX512
+#elif defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define MUJOCOEXT_MLP_AVX2
+#elif defined(__ARM_NEON)
+#define MUJOCOEXT_MLP_NEON
+#endif
+
+#if defined(MUJOCOEXT_MLP_AVX512) || defined(MUJOCOEXT_MLP_AVX2)
+#include <immintrin.h>
+#elif defined(MUJOCOEXT_MLP_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+/// Rounds the given size up to a multiple of the lane width
+auto PadToLaneWidth(int size) -> int {
+    return ((size + MLP_POLICY_LANE_WIDTH - 1) / MLP_POLICY_LANE_WIDTH) *
+           MLP_POLICY_LANE_WIDTH;
+}
+
+/// Accumulates out[0:stride] += scale * row[0:stride] (stride is padded)
+inline auto AxpyRow(float scale, const float* row, float* out, int stride)
+    -> void {
+#if defined(MUJOCOEXT_MLP_AVX512)
+    const __m512 v_scale = _mm512_set1_ps(scale);
+    for (int j = 0; j < stride; j += 16) {
+        __m512 v_out = _mm512_loadu_ps(out + j);
+        v_out = _mm512_fmadd_ps(v_scale, _mm512_loadu_ps(row + j), v_out);
+        _mm512_storeu_ps(out + j, v_out);
+    }
+#elif defined(MUJOCOEXT_MLP_AVX2)
+    const __m256 v_scale = _mm256_set1_ps(scale);
+    for (int j = 0; j < stride; j += 8) {
+        __m256 v_out = _mm256_loadu_ps(out + j);
+        v_out = _mm256_fmadd_ps(v_scale, _mm256_loadu_ps(row + j), v_out);
+        _mm256_storeu_ps(out + j, v_out);
+    }
+#elif defined(MUJOCOEXT_MLP_NEON)
+    const float32x4_t v_scale = vdupq_n_f32(scale);
+    for (int j = 0; j < stride; j += 4) {
+        float32x4_t v_out = vld1q_f32(out + j);
+        v_out = vfmaq_f32(v_out, v_scale, vld1q_f32(row + j));
+        vst1q_f32(out + j, v_out);
+    }
+#else
+    for (int j = 0; j < stride; ++j) {
+        out[j] += scale * row[j];  // NOLINT
+    }
+#endif
+}
+
+/// Applies out[0:stride] = max(out[0:stride], 0) (stride is padded)
+inline auto ReluRow(float* out, int stride) -> void {
+#if defined(MUJOCOEXT_MLP_AVX512)
+    const __m512 v_zero = _mm512_setzero_ps();
+    for (int j = 0; j < stride; j += 16) {
+        _mm512_storeu_ps(out + j,
+                         _mm512_max_ps(_mm512_loadu_ps(out + j), v_zero));
+    }
+#elif defined(MUJOCOEXT_MLP_AVX2)
+    const __m256 v_zero = _mm256_setzero_ps();
+    for (int j = 0; j < stride; j += 8) {
+        _mm256_storeu_ps(out + j,
+                         _mm256_max_ps(_mm256_loadu_ps(out + j), v_zero));
+    }
+#elif defined(MUJOCOEXT_MLP_NEON)
+    const float32x4_t v_zero = vdupq_n_f32(0.0F);
+    for (int j = 0; j < stride; j += 4) {
+        vst1q_f32(out + j, vmaxq_f32(vld1q_f32(out + j), v_zero));
+    }
+#else
+    for (int j = 0; j < stride; ++j) {
+        out[j] = std::max(out[j], 0.0F);  // NOLINT
+    }
+#endif
+}
+
+}  // namespace
+
+auto MlpPolicy::Load(const std::string& filepath) -> bool {
+    m_Layers.clear();
+
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "MlpPolicy >> couldn't open policy file [" << filepath
+                  << "]" << std::endl;
+        return false;
+    }
+
+    uint32_t header[3] = {0, 0, 0};  // NOLINT
+    file.read(reinterpret_cast<char*>(header), sizeof(header));  // NOLINT
+    if (!file || header[0] != MLP_POLICY_MAGIC || header[1] == 0 ||
+        header[1] > MLP_POLICY_MAX_LAYERS) {
+        std::cout << "MlpPolicy >> invalid header in policy file [" << filepath
+                  << "]" << std::endl;
+        return false;
+    }
+    const auto num_layers = header[1];
+    if (header[2] != static_cast<uint32_t>(MlpActivation::TANH) &&  // NOLINT
+        header[2] != static_cast<uint32_t>(MlpActivation::RELU)) {  // NOLINT
+        std::cout << "MlpPolicy >> unknown activation " << header[2]  // NOLINT
+                  << " in policy file [" << filepath << "]" << std::endl;
+        return false;
+    }
+    const auto activation = static_cast<MlpActivation>(header[2]);  // NOLINT
+
+    std::vector<uint32_t> sizes(num_layers + 1);
+    file.read(reinterpret_cast<char*>(sizes.data()),  // NOLINT
+              static_cast<std::streamsize>(sizes.size() * sizeof(uint32_t)));
+    const bool sizes_ok =
+        file && std::all_of(sizes.begin(), sizes.end(), [](uint32_t size) {
+            return size > 0 && size <= MLP_POLICY_MAX_LAYER_SIZE;
+        });
+    if (!sizes_ok) {
+        std::cout << "MlpPolicy >> invalid layer sizes in policy file ["
+                  << filepath << "]" << std::endl;
+        return false;
+    }
+
+    // Check the sizes against the file before allocating anything
+    uint64_t expected_size = sizeof(header) + sizes.size() * sizeof(uint32_t);
+    for (uint32_t l = 0; l < num_layers; ++l) {
+        expected_size += (static_cast<uint64_t>(sizes[l]) + 1) *
+                         static_cast<uint64_t>(sizes[l + 1]) * sizeof(float);
+    }
+    std::error_code error_code;
+    const auto file_size = std::filesystem::file_size(filepath, error_code);
+    if (error_code || file_size != expected_size) {
+        std::cout << "MlpPolicy >> policy file [" << filepath << "] has "
+                  << file_size << " bytes, but its layer sizes require "
+                  << expected_size << std::endl;
+        return false;
+    }
+
+    std::vector<Layer> layers(num_layers);
+    std::vector<float> weights_row_major;
+    for (uint32_t l = 0; l < num_layers; ++l) {
+        auto& layer = layers[l];
+        layer.in_size = static_cast<int>(sizes[l]);
+        layer.out_size = static_cast<int>(sizes[l + 1]);
+        layer.out_stride = PadToLaneWidth(layer.out_size);
+
+        // Weights come as [out][in]; store them transposed as [in][out] so
+        // that the kernels can broadcast an input and stream over the outputs
+        weights_row_major.resize(static_cast<size_t>(layer.out_size) *
+                                 static_cast<size_t>(layer.in_size));
+        file.read(reinterpret_cast<char*>(weights_row_major.data()),  // NOLINT
+                  static_cast<std::streamsize>(weights_row_major.size() *
+                                               sizeof(float)));
+        layer.weights.assign(static_cast<size_t>(layer.in_size) *
+                                 static_cast<size_t>(layer.out_stride),
+                             0.0F);
+        // Sizes go up to MLP_POLICY_MAX_LAYER_SIZE, so index in size_t
+        const auto in_size = static_cast<size_t>(layer.in_size);
+        const auto out_size = static_cast<size_t>(layer.out_size);
+        const auto out_stride = static_cast<size_t>(layer.out_stride);
+        for (size_t o = 0; o < out_size; ++o) {
+            for (size_t i = 0; i < in_size; ++i) {
+                layer.weights[i * out_stride + o] =
+                    weights_row_major[o * in_size + i];
+            }
+        }
+
+        layer.bias.assign(static_cast<size_t>(layer.out_stride), 0.0F);
+        file.read(reinterpret_cast<char*>(layer.bias.data()),  // NOLINT
+                  static_cast<std::streamsize>(layer.out_size * sizeof(float)));
+        if (!file) {
+            std::cout << "MlpPolicy >> policy file [" << filepath
+                      << "] ended before all weights were read" << std::endl;
+            return false;
+        }
+    }
+
+    m_Layers = std::move(layers);
+    m_Activation = activation;
+    m_InputSize = m_Layers.front().in_size;
+    m_OutputSize = m_Layers.back().out_size;
+    return true;
+}
+
+auto MlpPolicy::Evaluate(const float* obs_batch, int batch_size,
+                         float* act_batch) -> void {
+    if (m_Layers.empty() || batch_size <= 0) {
+        return;
+    }
+
+    int max_stride = 0;
+    for (const auto& layer : m_Layers) {
+        max_stride = std::max(max_stride, layer.out_stride);
+    }
+    const auto scratch_size =
+        static_cast<size_t>(batch_size) * static_cast<size_t>(max_stride);
+    for (auto& scratch : m_Scratch) {
+        if (scratch.size() < scratch_size) {
+            scratch.resize(scratch_size);
+        }
+    }
+
+    // The first layer reads the packed observations; all others read the
+    // padded output of the previous layer
+    const float* input = obs_batch;
+    int input_stride = m_InputSize;
+    for (size_t l = 0; l < m_Layers.size(); ++l) {
+        const auto& layer = m_Layers[l];
+        float* output = m_Scratch[l % 2].data();
+        const bool is_hidden = (l + 1) < m_Layers.size();
+        for (int b = 0; b < batch_size; ++b) {
+            const auto row = static_cast<size_t>(b);
+            const float* x =
+                input + row * static_cast<size_t>(input_stride);  // NOLINT
+            float* y =
+                output + row * static_cast<size_t>(layer.out_stride);  // NOLINT
+            std::copy(layer.bias.begin(), layer.bias.end(), y);
+            for (int i = 0; i < layer.in_size; ++i) {
+                const auto offset = static_cast<size_t>(i) *
+                                    static_cast<size_t>(layer.out_stride);
+                AxpyRow(x[i], layer.weights.data() + offset,  // NOLINT
+                        y, layer.out_stride);
+            }
+            if (!is_hidden) {
+                continue;
+            }
+            if (m_Activation == MlpActivation::RELU) {
+                ReluRow(y, layer.out_stride);
+            } else {
+                for (int j = 0; j < layer.out_size; ++j) {
+                    y[j] = std::tanh(y[j]);  // NOLINT
+                }
+            }
+        }
+        input = output;
+        input_stride = layer.out_stride;
+    }
+
+    // Unpack the (padded) output of the last layer into the actions buffer
+    for (int b = 0; b < batch_size; ++b) {
+        std::copy_n(input + b * input_stride, m_OutputSize,  // NOLINT
+                    act_batch + b * m_OutputSize);           // NOLINT
+    }
+}
+
+auto MlpPolicy::GetSimdBackend() -> const char* {
+#if defined(MUJOCOEXT_MLP_AVX512)
+    return "avx512";
+#elif defined(MUJOCOEXT_MLP_AVX2)
+    return "avx2";
+#elif defined(MUJOCOEXT_MLP_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,230 @@
+#include <core/model_library.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+
+// Compiling from a parsed spec avoids the global lock taken by mj_loadXML, so
+// models are compiled in parallel (older versions compile one at a time)
+#if defined(mjVERSION_HEADER) && mjVERSION_HEADER >= 320
+#define MUJOCOEXT_HAS_MODEL_SPECS
+#endif
+
+namespace {
+
+/// Size of the error buffer used when compiling a model
+constexpr size_t ERROR_BUFFER_SIZE = 1024;
+
+/// Compiles the model in the given xml file (nullptr on error)
+auto CompileModel(const std::string& filepath,
+                  std::array<char, ERROR_BUFFER_SIZE>& error) -> mjModel* {
+#ifdef MUJOCOEXT_HAS_MODEL_SPECS
+    mjSpec* spec = mj_parseXML(filepath.c_str(), nullptr, error.data(),
+                               static_cast<int>(error.size()));
+    if (spec == nullptr) {
+        return nullptr;
+    }
+    mjModel* model = mj_compile(spec, nullptr);
+    if (model == nullptr) {
+        std::strncpy(error.data(), mjs_getError(spec), error.size() - 1);
+    }
+    mj_deleteSpec(spec);
+    return model;
+#else
+    return mj_loadXML(filepath.c_str(), nullptr, error.data(),
+                      static_cast<int>(error.size()));
+#endif
+}
+
+}  // namespace
+
+ModelLibrary::ModelLibrary(size_t num_threads, int pool_size)
+    : m_PoolSize(std::max(pool_size, 0)), m_Pool(num_threads) {}
+
+auto ModelLibrary::Add(const std::string& filepath) -> int {
+    auto entry = std::make_shared<Entry>();
+    entry->path = filepath;
+    entry->name = std::filesystem::path(filepath).stem().string();
+
+    int id = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (size_t i = 0; i < m_Entries.size(); ++i) {
+            if (m_Entries[i]->path == filepath) {
+                return static_cast<int>(i);
+            }
+        }
+        id = static_cast<int>(m_Entries.size());
+        m_Entries.push_back(entry);
+        ++m_NumPending;
+    }
+    m_Pool.Enqueue([this, entry]() { _Compile(entry); });
+    return id;
+}
+
+auto ModelLibrary::AddDirectory(const std::string& dirpath) -> int {
+    std::error_code error_code;
+    std::vector<std::string> filepaths;
+    for (const auto& file :
+         std::filesystem::directory_iterator(dirpath, error_code)) {
+        if (file.is_regular_file() && file.path().extension() == ".xml") {
+            filepaths.push_back(file.path().string());
+        }
+    }
+    if (error_code) {
+        std::cout << "ModelLibrary >> couldn't list folder [" << dirpath
+                  << "]: " << error_code.message() << std::endl;
+        return 0;
+    }
+    // Sorted, so the ids don't depend on the order of the file system
+    std::sort(filepaths.begin(), filepaths.end());
+    for (const auto& filepath : filepaths) {
+        Add(filepath);
+    }
+    return static_cast<int>(filepaths.size());
+}
+
+auto ModelLibrary::_Compile(const std::shared_ptr<Entry>& entry) -> void {
+    std::array<char, ERROR_BUFFER_SIZE> error{};
+    auto* model = CompileModel(entry->path, error);
+    if (model != nullptr) {
+        entry->model = std::shared_ptr<mjModel>(model, MjcModelDeleter());
+        // The snapshot runs mj_forward, so it's also kept off the caller
+        entry->reset_cache = std::make_shared<ResetCache>(*entry->model);
+        for (int i = 0; i < m_PoolSize; ++i) {
+            entry->pool.emplace_back(mj_makeData(model));
+        }
+    } else {
+        entry->error = error.data();
+        std::cout << "ModelLibrary >> couldn't compile model [" << entry->path
+                  << "]: " << entry->error << std::endl;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        entry->status.store(
+            model != nullptr ? ModelStatus::READY : ModelStatus::FAILED,
+            std::memory_order_release);
+        --m_NumPending;
+    }
+    m_CondCompiled.notify_all();
+}
+
+auto ModelLibrary::Wait(int id) -> bool {
+    auto entry = _GetEntry(id);
+    if (entry == nullptr) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_CondCompiled.wait(lock, [&entry]() {
+        return entry->status.load() != ModelStatus::PENDING;
+    });
+    return entry->status.load() == ModelStatus::READY;
+}
+
+auto ModelLibrary::WaitAll() -> void {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_CondCompiled.wait(lock, [this]() { return m_NumPending == 0; });
+}
+
+auto ModelLibrary::Find(const std::string& name) const -> int {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (size_t i = 0; i < m_Entries.size(); ++i) {
+        if (m_Entries[i]->name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+auto ModelLibrary::GetStatus(int id) const -> ModelStatus {
+    auto entry = _GetEntry(id);
+    return entry != nullptr ? entry->status.load(std::memory_order_acquire)
+                            : ModelStatus::FAILED;
+}
+
+auto ModelLibrary::GetModel(int id) const -> std::shared_ptr<mjModel> {
+    auto entry = _GetReadyEntry(id);
+    return entry != nullptr ? entry->model : nullptr;
+}
+
+auto ModelLibrary::GetResetCache(int id) const -> std::shared_ptr<ResetCache> {
+    auto entry = _GetReadyEntry(id);
+    return entry != nullptr ? entry->reset_cache : nullptr;
+}
+
+auto ModelLibrary::Acquire(int id) -> std::shared_ptr<mjData> {
+    auto entry = _GetReadyEntry(id);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+
+    std::unique_ptr<mjData, MjcDataDeleter> data = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(entry->pool_mutex);
+        if (!entry->pool.empty()) {
+            data = std::move(entry->pool.back());
+            entry->pool.pop_back();
+        }
+    }
+    if (data == nullptr) {
+        data = std::unique_ptr<mjData, MjcDataDeleter>(
+            mj_makeData(entry->model.get()));
+    }
+    entry->reset_cache->Restore(*data);
+
+    // Back into the pool once released (deleted if the library is gone)
+    std::weak_ptr<Entry> weak_entry = entry;
+    return std::shared_ptr<mjData>(data.release(), [weak_entry](mjData* ptr) {
+        if (auto owner = weak_entry.lock()) {
+            std::lock_guard<std::mutex> lock(owner->pool_mutex);
+            owner->pool.emplace_back(ptr);
+        } else {
+            mj_deleteData(ptr);
+        }
+    });
+}
+
+auto ModelLibrary::GetName(int id) const -> std::string {
+    auto entry = _GetEntry(id);
+    return entry != nullptr ? entry->name : "";
+}
+
+auto ModelLibrary::GetPath(int id) const -> std::string {
+    auto entry = _GetEntry(id);
+    return entry != nullptr ? entry->path : "";
+}
+
+auto ModelLibrary::GetError(int id) const -> std::string {
+    auto entry = _GetEntry(id);
+    if (entry == nullptr ||
+        entry->status.load(std::memory_order_acquire) != ModelStatus::FAILED) {
+        return "";
+    }
+    return entry->error;
+}
+
+auto ModelLibrary::GetNumModels() const -> int {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return static_cast<int>(m_Entries.size());
+}
+
+auto ModelLibrary::_GetEntry(int id) const -> std::shared_ptr<Entry> {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (id < 0 || id >= static_cast<int>(m_Entries.size())) {
+        return nullptr;
+    }
+    return m_Entries[id];
+}
+
+auto ModelLibrary::_GetReadyEntry(int id) const -> std::shared_ptr<Entry> {
+    auto entry = _GetEntry(id);
+    if (entry == nullptr ||
+        entry->status.load(std::memory_order_acquire) != ModelStatus::READY) {
+        return nullptr;
+    }
+    return entry;
+}
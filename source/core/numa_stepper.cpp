@@ -0,0 +1,216 @@
+#include <core/numa_stepper.hpp>
+
+#include <algorithm>
+
+NumaStepper::NumaStepper(const mjModel& model, int num_envs,
+                         NumaStepperSettings settings,
+                         const NumaTopology& topology)
+    : m_Settings(settings), m_Topology(topology), m_SourceModel(&model) {
+    num_envs = std::max(num_envs, 0);
+    m_Data.resize(num_envs);
+    m_DataPtrs.resize(num_envs, nullptr);
+
+    const auto cpus = m_Topology.GetInterleavedCpus();
+    int num_threads = m_Settings.num_threads > 0
+                          ? m_Settings.num_threads
+                          : static_cast<int>(cpus.size());
+    num_threads = std::clamp(num_threads, 1, std::max(num_envs, 1));
+
+    // Workers alternate between nodes, and the first worker landing on a node
+    // makes that node's copy of the model
+    std::vector<int> node_replica(m_Topology.GetNumNodes(), -1);
+    int num_replicas = 0;
+    m_Workers = std::vector<Worker>(num_threads);
+    for (int w = 0; w < num_threads; ++w) {
+        auto& worker = m_Workers[w];
+        const int cpu = cpus.empty() ? -1 : cpus[w % cpus.size()];
+        if (m_Settings.pin_threads) {
+            worker.cpu = cpu;
+        }
+        if (m_Settings.replicate_model) {
+            const int node = std::max(m_Topology.GetNodeOfCpu(cpu), 0);
+            if (node_replica[node] < 0) {
+                node_replica[node] = num_replicas++;
+                worker.makes_replica = true;
+            }
+            worker.replica = node_replica[node];
+        }
+        worker.env_begin = num_envs * w / num_threads;
+        worker.env_end = num_envs * (w + 1) / num_threads;
+    }
+
+    m_Replicas.resize(std::max(num_replicas, 1));
+    if (!m_Settings.replicate_model) {
+        m_Replicas[0].model = &model;
+        m_Replicas[0].reset_cache = std::make_unique<ResetCache>(model);
+    }
+    if (!m_Settings.local_data) {
+        for (int env = 0; env < num_envs; ++env) {
+            m_Data[env].reset(mj_makeData(&model));
+            m_DataPtrs[env] = m_Data[env].get();
+        }
+    }
+
+    for (int w = 0; w < num_threads; ++w) {
+        m_Workers[w].thread = std::thread([this, w]() { _WorkerLoop(w); });
+    }
+    if (m_Settings.replicate_model) {
+        _Dispatch(Command::REPLICATE);
+    }
+    // Also resets the simulations allocated above (and publishes the result
+    // of pinning the workers)
+    _Dispatch(Command::ALLOCATE);
+}
+
+NumaStepper::~NumaStepper() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Command = Command::STOP;
+        ++m_Generation;
+    }
+    m_CondCommand.notify_all();
+    for (auto& worker : m_Workers) {
+        worker.thread.join();
+    }
+}
+
+auto NumaStepper::Step(int num_steps) -> void {
+    if (num_steps > 0) {
+        _Dispatch(Command::STEP, num_steps);
+    }
+}
+
+auto NumaStepper::Reset() -> void { _Dispatch(Command::RESET); }
+
+auto NumaStepper::SetController(std::shared_ptr<Controller> controller)
+    -> void {
+    m_Controller = std::move(controller);
+    for (auto& worker : m_Workers) {
+        worker.controller = nullptr;
+    }
+}
+
+auto NumaStepper::SetControllerFactory(
+    const std::function<std::shared_ptr<Controller>()>& factory) -> void {
+    m_Controller = nullptr;
+    for (auto& worker : m_Workers) {
+        worker.controller = factory ? factory() : nullptr;
+    }
+}
+
+auto NumaStepper::GetModel(int env) const -> const mjModel& {
+    for (const auto& worker : m_Workers) {
+        if (env < worker.env_end) {
+            return *m_Replicas[worker.replica].model;
+        }
+    }
+    return *m_SourceModel;
+}
+
+auto NumaStepper::GetNumPinned() const -> int {
+    return static_cast<int>(
+        std::count_if(m_Workers.begin(), m_Workers.end(),
+                      [](const Worker& worker) { return worker.pinned; }));
+}
+
+auto NumaStepper::_WorkerLoop(int index) -> void {
+    auto& worker = m_Workers[index];
+    if (worker.cpu >= 0) {
+        worker.pinned = NumaTopology::PinCurrentThread(worker.cpu);
+    }
+
+    uint64_t generation = 0;
+    while (true) {
+        Command command = Command::STOP;
+        int num_steps = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_CondCommand.wait(lock, [this, generation]() {
+                return m_Generation != generation;
+            });
+            generation = m_Generation;
+            command = m_Command;
+            num_steps = m_NumSteps;
+        }
+        if (command == Command::STOP) {
+            return;
+        }
+
+        _Execute(worker, command, num_steps);
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (--m_NumPending == 0) {
+            m_CondDone.notify_one();
+        }
+    }
+}
+
+auto NumaStepper::_Execute(Worker& worker, Command command, int num_steps)
+    -> void {
+    auto& replica = m_Replicas[worker.replica];
+    switch (command) {
+        case Command::REPLICATE: {
+            if (worker.makes_replica) {
+                // Copied (and thus first touched) from a cpu of the node
+                replica.copy.reset(mj_copyModel(nullptr, m_SourceModel));
+                replica.model = replica.copy.get();
+                replica.reset_cache =
+                    std::make_unique<ResetCache>(*replica.model);
+            }
+            break;
+        }
+        case Command::ALLOCATE: {
+            for (int env = worker.env_begin; env < worker.env_end; ++env) {
+                if (m_Data[env] == nullptr) {
+                    m_Data[env].reset(mj_makeData(replica.model));
+                    m_DataPtrs[env] = m_Data[env].get();
+                }
+                replica.reset_cache->Restore(*m_Data[env], env);
+            }
+            break;
+        }
+        case Command::STEP: {
+            const int batch_size = worker.env_end - worker.env_begin;
+            mjData* const* data_batch =
+                m_DataPtrs.data() + worker.env_begin;  // NOLINT
+            for (int step = 0; step < num_steps; ++step) {
+                if (worker.controller != nullptr && batch_size > 0) {
+                    worker.controller->ComputeBatch(*replica.model, data_batch,
+                                                    batch_size);
+                } else if (m_Controller != nullptr && batch_size > 0) {
+                    std::lock_guard<std::mutex> lock(m_ControllerMutex);
+                    m_Controller->ComputeBatch(*replica.model, data_batch,
+                                               batch_size);
+                }
+                for (int i = 0; i < batch_size; ++i) {
+                    for (int s = 0; s < m_Settings.num_substeps; ++s) {
+                        mj_step(replica.model, data_batch[i]);  // NOLINT
+                    }
+                }
+            }
+            break;
+        }
+        case Command::RESET: {
+            for (int env = worker.env_begin; env < worker.env_end; ++env) {
+                replica.reset_cache->Restore(*m_Data[env], env);
+            }
+            break;
+        }
+        case Command::STOP:
+            break;
+    }
+}
+
+auto NumaStepper::_Dispatch(Command command, int num_steps) -> void {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Command = command;
+        m_NumSteps = num_steps;
+        m_NumPending = static_cast<int>(m_Workers.size());
+        ++m_Generation;
+    }
+    m_CondCommand.notify_all();
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_CondDone.wait(lock, [this]() { return m_NumPending == 0; });
+}
@@ -0,0 +1,176 @@
+#include <core/numa_topology.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#define MUJOCOEXT_HAS_CPU_AFFINITY
+#endif
+
+namespace {
+
+/// Folder where Linux exposes the NUMA nodes
+constexpr const char* SYS_NODES_PATH = "/sys/devices/system/node";
+
+/// Returns the cpus this process is allowed to run on
+auto GetAllowedCpus() -> std::vector<int> {
+    std::vector<int> cpus;
+#ifdef MUJOCOEXT_HAS_CPU_AFFINITY
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpu_set)) {  // NOLINT
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        const auto num_cpus =
+            std::max(1U, std::thread::hardware_concurrency());
+        for (unsigned int cpu = 0; cpu < num_cpus; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+}  // namespace
+
+auto NumaTopology::Detect() -> NumaTopology {
+    const auto allowed = GetAllowedCpus();
+    NumaTopology topology;
+
+    std::error_code error_code;
+    for (const auto& entry :
+         std::filesystem::directory_iterator(SYS_NODES_PATH, error_code)) {
+        const auto name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() <= 4 ||
+            !std::all_of(name.begin() + 4, name.end(),
+                         [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        std::ifstream cpulist_file(entry.path() / "cpulist");
+        std::string cpu_list;
+        std::getline(cpulist_file, cpu_list);
+
+        NumaNode node;
+        node.id = std::stoi(name.substr(4));
+        for (const int cpu : ParseCpuList(cpu_list)) {
+            if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        // Memory-only nodes (or nodes we're not allowed to run on) are skipped
+        if (!node.cpus.empty()) {
+            topology.m_Nodes.push_back(std::move(node));
+        }
+    }
+
+    if (topology.m_Nodes.empty()) {
+        return SingleNode(allowed);
+    }
+    std::sort(topology.m_Nodes.begin(), topology.m_Nodes.end(),
+              [](const NumaNode& lhs, const NumaNode& rhs) {
+                  return lhs.id < rhs.id;
+              });
+    return topology;
+}
+
+auto NumaTopology::SingleNode(std::vector<int> cpus) -> NumaTopology {
+    NumaTopology topology;
+    NumaNode node;
+    node.cpus = std::move(cpus);
+    topology.m_Nodes.push_back(std::move(node));
+    return topology;
+}
+
+auto NumaTopology::ParseCpuList(const std::string& cpu_list)
+    -> std::vector<int> {
+    std::vector<int> cpus;
+    std::stringstream stream(cpu_list);
+    std::string range;
+    try {
+        while (std::getline(stream, range, ',')) {
+            if (range.empty() || range == "\n") {
+                continue;
+            }
+            const auto dash = range.find('-');
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = dash == std::string::npos
+                                 ? first
+                                 : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+    } catch (const std::exception&) {
+        return {};
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+auto NumaTopology::PinCurrentThread(int cpu) -> bool {
+#ifdef MUJOCOEXT_HAS_CPU_AFFINITY
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);  // NOLINT
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set),
+                                  &cpu_set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+auto NumaTopology::GetNumCpus() const -> int {
+    int num_cpus = 0;
+    for (const auto& node : m_Nodes) {
+        num_cpus += static_cast<int>(node.cpus.size());
+    }
+    return num_cpus;
+}
+
+auto NumaTopology::GetInterleavedCpus() const -> std::vector<int> {
+    std::vector<int> cpus;
+    for (size_t i = 0; cpus.size() < static_cast<size_t>(GetNumCpus()); ++i) {
+        for (const auto& node : m_Nodes) {
+            if (i < node.cpus.size()) {
+                cpus.push_back(node.cpus[i]);
+            }
+        }
+    }
+    return cpus;
+}
+
+auto NumaTopology::GetNodeOfCpu(int cpu) const -> int {
+    for (size_t n = 0; n < m_Nodes.size(); ++n) {
+        const auto& cpus = m_Nodes[n].cpus;
+        if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) {
+            return static_cast<int>(n);
+        }
+    }
+    return -1;
+}
+
+auto NumaTopology::ToString() const -> std::string {
+    std::stringstream stream;
+    stream << m_Nodes.size() << " node(s), " << GetNumCpus() << " cpu(s)";
+    for (const auto& node : m_Nodes) {
+        stream << "\n  node " << node.id << ": " << node.cpus.size()
+               << " cpu(s)";
+    }
+    return stream.str();
+}
@@ -0,0 +1,75 @@
+#include <core/policy_controller.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+PolicyController::PolicyController(std::shared_ptr<MlpPolicy> policy,
+                                   ObservationFn observation_fn)
+    : m_Policy(std::move(policy)), m_ObservationFn(std::move(observation_fn)) {
+    if (!m_ObservationFn) {
+        m_DefaultObservation = true;
+        m_ObservationFn = [](const mjModel& model, const mjData& data,
+                             float* obs) {
+            std::copy_n(data.qpos, model.nq, obs);
+            std::copy_n(data.qvel, model.nv, obs + model.nq);  // NOLINT
+        };
+    }
+}
+
+auto PolicyController::Compute(const mjModel& model, mjData& data) -> void {
+    mjData* data_batch[1] = {&data};  // NOLINT
+    ComputeBatch(model, data_batch, 1);
+}
+
+auto PolicyController::ComputeBatch(const mjModel& model,
+                                    mjData* const* data_batch, int batch_size)
+    -> void {
+    if (m_Policy == nullptr || !m_Policy->IsLoaded() || batch_size <= 0 ||
+        !_IsCompatible(model)) {
+        return;
+    }
+
+    const auto obs_size = static_cast<size_t>(m_Policy->GetInputSize());
+    const auto act_size = static_cast<size_t>(m_Policy->GetOutputSize());
+    const auto num_envs = static_cast<size_t>(batch_size);
+    m_ObsBuffer.resize(num_envs * obs_size);
+    m_ActBuffer.resize(num_envs * act_size);
+
+    // Gather the observations of all environments into one packed buffer
+    for (size_t i = 0; i < num_envs; ++i) {
+        m_ObservationFn(model, *data_batch[i],               // NOLINT
+                        m_ObsBuffer.data() + i * obs_size);  // NOLINT
+    }
+
+    m_Policy->Evaluate(m_ObsBuffer.data(), batch_size, m_ActBuffer.data());
+
+    // Scatter the actions back into each environment's ctrl buffer
+    for (size_t i = 0; i < num_envs; ++i) {
+        const float* action = m_ActBuffer.data() + i * act_size;  // NOLINT
+        mjtNum* ctrl = data_batch[i]->ctrl;                       // NOLINT
+        for (size_t j = 0; j < act_size; ++j) {
+            ctrl[j] = static_cast<mjtNum>(action[j]);  // NOLINT
+        }
+    }
+}
+
+auto PolicyController::_IsCompatible(const mjModel& model) -> bool {
+    const bool obs_ok = !m_DefaultObservation ||
+                        m_Policy->GetInputSize() == model.nq + model.nv;
+    const bool act_ok = m_Policy->GetOutputSize() == model.nu;
+    if (obs_ok && act_ok) {
+        return true;
+    }
+    // Reported once per model, as this is checked on every step
+    if (m_RejectedModel != &model) {
+        m_RejectedModel = &model;
+        std::cout << "PolicyController >> policy with "
+                  << m_Policy->GetInputSize() << " inputs and "
+                  << m_Policy->GetOutputSize()
+                  << " outputs doesn't match the model (nq + nv = "
+                  << model.nq + model.nv << ", nu = " << model.nu
+                  << "), not computing any controls" << std::endl;
+    }
+    return false;
+}
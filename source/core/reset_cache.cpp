@@ -0,0 +1,78 @@
+#include <core/reset_cache.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+// Active equality constraints became part of the state (mjData) in MuJoCo 3
+#if defined(mjVERSION_HEADER) && mjVERSION_HEADER >= 300
+#define MUJOCOEXT_HAS_EQ_ACTIVE_STATE
+#endif
+
+ResetCache::ResetCache(const mjModel& model, int key_id)
+    : m_Model(model), m_KeyId(key_id) {
+    if (m_KeyId >= m_Model.nkey) {
+        std::cout << "ResetCache >> keyframe [" << m_KeyId
+                  << "] out of range, using the default initial state"
+                  << std::endl;
+        m_KeyId = -1;
+    }
+    m_Snapshot = std::unique_ptr<mjData, MjcDataDeleter>(mj_makeData(&m_Model));
+    Capture();
+}
+
+auto ResetCache::Capture() -> void {
+    if (m_KeyId < 0) {
+        mj_resetData(&m_Model, m_Snapshot.get());
+    } else {
+        mj_resetDataKeyframe(&m_Model, m_Snapshot.get(), m_KeyId);
+    }
+    mj_forward(&m_Model, m_Snapshot.get());
+}
+
+auto ResetCache::Restore(mjData& data, int index) const -> void {
+    const auto& src = *m_Snapshot;
+    if (m_Mode == ResetMode::FULL) {
+        // Reuses the buffers already allocated by the destination
+        mj_copyData(&data, &m_Model, &src);
+    } else {
+        const auto& model = m_Model;
+        data.time = src.time;
+        mju_copy(data.qpos, src.qpos, model.nq);
+        mju_copy(data.qvel, src.qvel, model.nv);
+        mju_copy(data.act, src.act, model.na);
+        mju_copy(data.qacc_warmstart, src.qacc_warmstart, model.nv);
+        mju_copy(data.ctrl, src.ctrl, model.nu);
+        mju_copy(data.qfrc_applied, src.qfrc_applied, model.nv);
+        mju_copy(data.xfrc_applied, src.xfrc_applied, 6 * model.nbody);
+        mju_copy(data.mocap_pos, src.mocap_pos, 3 * model.nmocap);
+        mju_copy(data.mocap_quat, src.mocap_quat, 4 * model.nmocap);
+        mju_copy(data.userdata, src.userdata, model.nuserdata);
+        // Same fields as mjSTATE_INTEGRATION (without the mj_getState buffer)
+        mju_copy(data.plugin_state, src.plugin_state, model.npluginstate);
+#ifdef MUJOCOEXT_HAS_EQ_ACTIVE_STATE
+        std::copy_n(src.eq_active, model.neq, data.eq_active);
+#endif
+    }
+
+    if (m_JitterFn) {
+        m_JitterFn(m_Model, data, index);
+    }
+}
+
+auto ResetCache::RestoreBatch(mjData* const* data_batch, int batch_size,
+                              const uint8_t* mask, ThreadPool* pool) const
+    -> void {
+    auto restore_fn = [&](int i) {
+        if (mask == nullptr || mask[i] != 0) {  // NOLINT
+            Restore(*data_batch[i], i);         // NOLINT
+        }
+    };
+
+    if (pool == nullptr) {
+        for (int i = 0; i < batch_size; ++i) {
+            restore_fn(i);
+        }
+    } else {
+        pool->ParallelFor(batch_size, restore_fn);
+    }
+}
@@ -0,0 +1,399 @@
+#include <core/rollout_coordinator.hpp>
+
+#include <poll.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+/// Maximum number of pending connections on the listening socket
+constexpr int LISTEN_BACKLOG = 64;
+/// Number of bits used for the chunk index in the ids sent to the workers
+constexpr uint32_t CHUNK_INDEX_BITS = 32;
+/// Mask that extracts the chunk index from the ids sent to the workers
+constexpr uint64_t CHUNK_INDEX_MASK = (1ULL << CHUNK_INDEX_BITS) - 1;
+
+/// Returns the seconds elapsed between the given time points
+template <typename TimePoint>
+auto Seconds(const TimePoint& from, const TimePoint& to) -> double {
+    return std::chrono::duration<double>(to - from).count();
+}
+
+}  // namespace
+
+RolloutCoordinator::RolloutCoordinator(RolloutCoordinatorSettings settings)
+    : m_Settings(settings) {}
+
+RolloutCoordinator::~RolloutCoordinator() {
+    Shutdown();
+    if (m_ListenFd >= 0) {
+        RolloutClose(m_ListenFd, m_Address);
+        m_ListenFd = -1;
+    }
+}
+
+auto RolloutCoordinator::Listen(const std::string& address) -> bool {
+    if (m_ListenFd >= 0) {
+        RolloutClose(m_ListenFd, m_Address);
+    }
+    m_Address = address;
+    m_ListenFd = RolloutListen(address, LISTEN_BACKLOG);
+    return m_ListenFd >= 0;
+}
+
+auto RolloutCoordinator::WaitForWorkers(size_t num_workers, double timeout)
+    -> size_t {
+    const auto start = Clock::now();
+    while (m_ListenFd >= 0 && m_Workers.size() < num_workers &&
+           Seconds(start, Clock::now()) < timeout) {
+        pollfd listen_poll{m_ListenFd, POLLIN, 0};
+        if (poll(&listen_poll, 1, m_Settings.poll_interval_ms) > 0) {
+            _AcceptWorkers();
+        }
+    }
+    return m_Workers.size();
+}
+
+auto RolloutCoordinator::MakeChunks(uint32_t num_envs, uint32_t chunk_size,
+                                    uint32_t num_steps, uint32_t seed)
+    -> std::vector<RolloutChunk> {
+    std::vector<RolloutChunk> chunks;
+    chunk_size = std::max<uint32_t>(chunk_size, 1);
+    for (uint32_t begin = 0; begin < num_envs; begin += chunk_size) {
+        RolloutChunk chunk;
+        chunk.id = chunks.size();
+        chunk.env_begin = begin;
+        chunk.num_envs = std::min(chunk_size, num_envs - begin);
+        chunk.num_steps = num_steps;
+        chunk.seed = seed;
+        chunks.push_back(chunk);
+    }
+    return chunks;
+}
+
+auto RolloutCoordinator::Run(const std::vector<RolloutChunk>& chunks)
+    -> bool {
+    const auto run_start = Clock::now();
+    ++m_RunIndex;
+    m_Stats = RolloutStats{};
+    m_Chunks = chunks;
+    for (size_t i = 0; i < m_Chunks.size(); ++i) {
+        m_Chunks[i].id = (m_RunIndex << CHUNK_INDEX_BITS) | i;
+    }
+    m_ChunkStates.assign(m_Chunks.size(), ChunkState{});
+    m_Results.assign(m_Chunks.size(), {});
+    m_Orphans.clear();
+    m_NumDone = 0;
+    m_TotalChunkTime = 0.0;
+
+    // Give each connected worker a contiguous range of chunks. Workers that
+    // connect later start by stealing
+    const auto num_workers = m_Workers.size();
+    for (size_t w = 0; w < num_workers; ++w) {
+        auto& worker = m_Workers[w];
+        worker.queue.clear();
+        // Results of chunks from previous runs are discarded when received
+        worker.current = -1;
+        const auto begin = (w * m_Chunks.size()) / num_workers;
+        const auto end = ((w + 1) * m_Chunks.size()) / num_workers;
+        for (auto i = begin; i < end; ++i) {
+            worker.queue.push_back(i);
+        }
+    }
+    if (num_workers == 0) {
+        for (size_t i = 0; i < m_Chunks.size(); ++i) {
+            m_Orphans.push_back(i);
+        }
+    }
+
+    auto last_worker_seen = Clock::now();
+    std::vector<pollfd> poll_fds;
+    while (m_NumDone < m_Chunks.size()) {
+        poll_fds.clear();
+        poll_fds.push_back({m_ListenFd, POLLIN, 0});
+        for (const auto& worker : m_Workers) {
+            poll_fds.push_back({worker.socket_fd, POLLIN, 0});
+        }
+        if (poll(poll_fds.data(), static_cast<nfds_t>(poll_fds.size()),
+                 m_Settings.poll_interval_ms) < 0 &&
+            errno != EINTR) {
+            std::cout << "RolloutCoordinator >> poll failed: "
+                      << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        // Handle the messages first (new workers are appended at the back)
+        for (size_t w = 0; w + 1 < poll_fds.size(); ++w) {
+            const auto events = poll_fds[w + 1].revents;
+            if ((events & (POLLIN | POLLHUP | POLLERR)) == 0) {
+                continue;
+            }
+            _ReceiveMessages(m_Workers[w]);
+        }
+        if ((poll_fds[0].revents & POLLIN) != 0) {
+            _AcceptWorkers();
+        }
+
+        // Workers stuck on a chunk (or a message) for too long are lost
+        const auto now = Clock::now();
+        for (auto& worker : m_Workers) {
+            if (!worker.lost && !worker.buffer.empty() &&
+                Seconds(worker.receive_start, now) > m_Settings.io_timeout) {
+                std::cout << "RolloutCoordinator >> worker " << worker.pid
+                          << " timed out sending a message" << std::endl;
+                _DropWorker(worker);
+            }
+            if (worker.current >= 0 &&
+                Seconds(worker.start, now) > m_Settings.chunk_timeout) {
+                std::cout << "RolloutCoordinator >> worker " << worker.pid
+                          << " timed out on chunk " << worker.current
+                          << std::endl;
+                _DropWorker(worker);
+            }
+        }
+        _RemoveLostWorkers();
+
+        for (auto& worker : m_Workers) {
+            if (!worker.waiting) {
+                continue;
+            }
+            const auto index = _NextChunk(worker);
+            if (index < 0) {
+                continue;
+            }
+            auto& state = m_ChunkStates[index];
+            if (!RolloutSend(worker.socket_fd, RolloutMessageType::CHUNK,
+                             &m_Chunks[index], sizeof(RolloutChunk))) {
+                // Nothing was handed out, so the chunk goes back unassigned
+                m_Orphans.push_front(static_cast<size_t>(index));
+                _DropWorker(worker);
+                continue;
+            }
+            if (state.num_running == 0) {
+                state.start = now;
+            }
+            ++state.num_running;
+            ++m_Stats.num_dispatched;
+            worker.waiting = false;
+            worker.current = index;
+            worker.start = now;
+        }
+        _RemoveLostWorkers();
+
+        if (!m_Workers.empty()) {
+            last_worker_seen = now;
+        } else if (Seconds(last_worker_seen, now) >
+                   m_Settings.no_worker_timeout) {
+            std::cout << "RolloutCoordinator >> no workers left, "
+                      << (m_Chunks.size() - m_NumDone)
+                      << " chunks weren't completed" << std::endl;
+            m_Stats.duration = Seconds(run_start, Clock::now());
+            return false;
+        }
+    }
+    m_Stats.duration = Seconds(run_start, Clock::now());
+    return true;
+}
+
+auto RolloutCoordinator::Shutdown() -> void {
+    for (auto& worker : m_Workers) {
+        RolloutSend(worker.socket_fd, RolloutMessageType::SHUTDOWN, nullptr,
+                    0);
+        RolloutClose(worker.socket_fd);
+    }
+    m_Workers.clear();
+}
+
+auto RolloutCoordinator::_AcceptWorkers() -> void {
+    int socket_fd = -1;
+    while ((socket_fd = RolloutAccept(m_ListenFd)) >= 0) {
+        RolloutSetTimeout(socket_fd, m_Settings.io_timeout);
+        WorkerState worker;
+        worker.socket_fd = socket_fd;
+        m_Workers.push_back(std::move(worker));
+    }
+}
+
+auto RolloutCoordinator::_ReceiveMessages(WorkerState& worker) -> void {
+    const bool was_idle = worker.buffer.empty();
+    // Complete messages sent before a disconnection are still handled
+    const bool connected =
+        RolloutReceiveAvailable(worker.socket_fd, worker.buffer);
+
+    size_t offset = 0;
+    RolloutMessage message;
+    auto result = RolloutParseResult::INCOMPLETE;
+    while (!worker.lost &&
+           (result = RolloutParseMessage(worker.buffer, offset, message)) ==
+               RolloutParseResult::MESSAGE) {
+        _HandleMessage(worker, message);
+    }
+    if (worker.lost) {
+        return;
+    }
+    if (!connected || result == RolloutParseResult::INVALID) {
+        _DropWorker(worker);
+        return;
+    }
+    worker.buffer.erase(worker.buffer.begin(),
+                        worker.buffer.begin() +
+                            static_cast<std::ptrdiff_t>(offset));
+    if (was_idle || offset > 0) {
+        worker.receive_start = Clock::now();
+    }
+}
+
+auto RolloutCoordinator::_HandleMessage(WorkerState& worker,
+                                        const RolloutMessage& message)
+    -> void {
+    switch (message.type) {
+        case RolloutMessageType::HELLO:
+            if (message.payload.size() == sizeof(worker.pid)) {
+                std::memcpy(&worker.pid, message.payload.data(),
+                            sizeof(worker.pid));
+            }
+            break;
+        case RolloutMessageType::REQUEST:
+            worker.waiting = true;
+            break;
+        case RolloutMessageType::RESULT: {
+            uint64_t id = 0;
+            if (message.payload.size() < sizeof(id)) {
+                _DropWorker(worker);
+                break;
+            }
+            std::memcpy(&id, message.payload.data(), sizeof(id));
+            const auto index = static_cast<size_t>(id & CHUNK_INDEX_MASK);
+            const bool is_current =
+                (id >> CHUNK_INDEX_BITS) == m_RunIndex &&
+                index < m_Chunks.size() &&
+                worker.current == static_cast<int64_t>(index);
+            worker.current = -1;
+            if (!is_current) {
+                // Leftover from a previous run
+                break;
+            }
+            auto& state = m_ChunkStates[index];
+            state.num_running = std::max(state.num_running - 1, 0);
+            if (state.done) {
+                ++m_Stats.num_duplicates;
+                break;
+            }
+            state.done = true;
+            m_Results[index].assign(message.payload.begin() + sizeof(id),
+                                    message.payload.end());
+            m_TotalChunkTime += Seconds(worker.start, Clock::now());
+            ++m_NumDone;
+            break;
+        }
+        default:
+            _DropWorker(worker);
+            break;
+    }
+}
+
+auto RolloutCoordinator::_NextChunk(WorkerState& worker) -> int64_t {
+    const auto pop_pending = [this](std::deque<size_t>& queue,
+                                    bool from_back) -> int64_t {
+        while (!queue.empty()) {
+            const auto index = from_back ? queue.back() : queue.front();
+            if (from_back) {
+                queue.pop_back();
+            } else {
+                queue.pop_front();
+            }
+            if (!m_ChunkStates[index].done) {
+                return static_cast<int64_t>(index);
+            }
+        }
+        return -1;
+    };
+
+    // Own queue first (contiguous chunks), then the chunks of lost workers
+    auto index = pop_pending(worker.queue, false);
+    if (index < 0) {
+        index = pop_pending(m_Orphans, false);
+    }
+    if (index >= 0) {
+        return index;
+    }
+
+    // Steal from the back of the longest queue, the furthest away from the
+    // chunks its owner is working on
+    WorkerState* victim = nullptr;
+    for (auto& other : m_Workers) {
+        if (&other != &worker && !other.lost &&
+            (victim == nullptr || other.queue.size() > victim->queue.size())) {
+            victim = &other;
+        }
+    }
+    if (victim != nullptr) {
+        index = pop_pending(victim->queue, true);
+        if (index >= 0) {
+            ++m_Stats.num_stolen;
+            return index;
+        }
+    }
+
+    // Nothing left to hand out: duplicate the oldest straggler, if any
+    if (m_NumDone == 0) {
+        return -1;
+    }
+    const auto now = Clock::now();
+    const auto threshold = m_Settings.straggler_factor * m_TotalChunkTime /
+                           static_cast<double>(m_NumDone);
+    double oldest = threshold;
+    for (const auto& other : m_Workers) {
+        if (&other == &worker || other.current < 0) {
+            continue;
+        }
+        const auto& state = m_ChunkStates[other.current];
+        const auto elapsed = Seconds(state.start, now);
+        if (!state.done && state.num_running == 1 && elapsed > oldest) {
+            oldest = elapsed;
+            index = other.current;
+        }
+    }
+    if (index >= 0) {
+        ++m_Stats.num_speculative;
+    }
+    return index;
+}
+
+auto RolloutCoordinator::_DropWorker(WorkerState& worker) -> void {
+    if (worker.lost) {
+        return;
+    }
+    worker.lost = true;
+    worker.waiting = false;
+    ++m_Stats.num_lost_workers;
+    std::cout << "RolloutCoordinator >> lost worker " << worker.pid
+              << std::endl;
+    RolloutClose(worker.socket_fd);
+    worker.socket_fd = -1;
+
+    if (worker.current >= 0) {
+        auto& state = m_ChunkStates[worker.current];
+        state.num_running = std::max(state.num_running - 1, 0);
+        if (!state.done && state.num_running == 0) {
+            m_Orphans.push_front(static_cast<size_t>(worker.current));
+            ++m_Stats.num_reissued;
+        }
+        worker.current = -1;
+    }
+    for (const auto index : worker.queue) {
+        m_Orphans.push_back(index);
+    }
+    worker.queue.clear();
+}
+
+auto RolloutCoordinator::_RemoveLostWorkers() -> void {
+    m_Workers.erase(std::remove_if(m_Workers.begin(), m_Workers.end(),
+                                   [](const WorkerState& worker) {
+                                       return worker.lost;
+                                   }),
+                    m_Workers.end());
+}
@@ -0,0 +1,347 @@
+#include <core/rollout_protocol.hpp>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef MSG_NOSIGNAL
+static constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static constexpr int SEND_FLAGS = 0;
+#endif
+
+#ifdef SOCK_CLOEXEC
+static constexpr int SOCKET_FLAGS = SOCK_CLOEXEC;
+#else
+static constexpr int SOCKET_FLAGS = 0;
+#endif
+
+namespace {
+
+/// Returns whether the address refers to a TCP endpoint
+auto IsTcpAddress(const std::string& address) -> bool {
+    return address.rfind(ROLLOUT_TCP_PREFIX, 0) == 0;
+}
+
+/// Resolves a tcp://host:port address
+auto ResolveTcpAddress(const std::string& address, bool passive)
+    -> addrinfo* {
+    const auto host_port = address.substr(std::strlen(ROLLOUT_TCP_PREFIX));
+    const auto separator = host_port.rfind(':');
+    if (separator == std::string::npos) {
+        return nullptr;
+    }
+    const auto host = host_port.substr(0, separator);
+    const auto port = host_port.substr(separator + 1);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(),
+                    &hints, &result) != 0) {
+        return nullptr;
+    }
+    return result;
+}
+
+/// Fills a unix-socket address (returns false if the path is too long)
+auto MakeUnixAddress(const std::string& path, sockaddr_un& address) -> bool {
+    if (path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(),  // NOLINT
+                 sizeof(address.sun_path) - 1);
+    return true;
+}
+
+/// Maximum number of bytes read from a socket per call to ReceiveAvailable,
+/// so a single connection can't monopolize the caller
+constexpr size_t MAX_RECEIVE_SIZE = 1U << 20U;
+/// Size of each read done by ReceiveAvailable
+constexpr size_t RECEIVE_BLOCK_SIZE = 1U << 16U;
+
+/// Creates a socket that isn't inherited by programs started with exec
+auto MakeSocket(int family, int type) -> int {
+    const int socket_fd = socket(family, type | SOCKET_FLAGS, 0);
+    if (SOCKET_FLAGS == 0 && socket_fd >= 0) {
+        fcntl(socket_fd, F_SETFD, FD_CLOEXEC);  // NOLINT
+    }
+    return socket_fd;
+}
+
+/// Avoids SIGPIPE on platforms without MSG_NOSIGNAL
+auto DisableSigPipe(int socket_fd) -> void {
+#ifdef SO_NOSIGPIPE
+    const int enable = 1;
+    setsockopt(socket_fd, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#else
+    (void)socket_fd;
+#endif
+}
+
+/// Writes the whole buffer (retrying on partial writes)
+auto WriteAll(int socket_fd, const uint8_t* buffer, size_t size) -> bool {
+    while (size > 0) {
+        const auto num_bytes = send(socket_fd, buffer, size, SEND_FLAGS);
+        if (num_bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (num_bytes <= 0) {
+            return false;
+        }
+        buffer += num_bytes;  // NOLINT
+        size -= static_cast<size_t>(num_bytes);
+    }
+    return true;
+}
+
+/// Reads exactly size bytes (retrying on partial reads)
+auto ReadAll(int socket_fd, uint8_t* buffer, size_t size) -> bool {
+    while (size > 0) {
+        const auto num_bytes = recv(socket_fd, buffer, size, 0);
+        if (num_bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (num_bytes <= 0) {
+            return false;
+        }
+        buffer += num_bytes;  // NOLINT
+        size -= static_cast<size_t>(num_bytes);
+    }
+    return true;
+}
+
+}  // namespace
+
+auto RolloutListen(const std::string& address, int backlog) -> int {
+    int socket_fd = -1;
+    if (IsTcpAddress(address)) {
+        auto* info = ResolveTcpAddress(address, true);
+        if (info == nullptr) {
+            std::cout << "Rollout >> invalid address [" << address << "]"
+                      << std::endl;
+            return -1;
+        }
+        socket_fd = MakeSocket(info->ai_family, info->ai_socktype);
+        const int reuse = 1;
+        if (socket_fd >= 0) {
+            setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                       sizeof(reuse));
+        }
+        if (socket_fd >= 0 &&
+            bind(socket_fd, info->ai_addr, info->ai_addrlen) != 0) {
+            close(socket_fd);
+            socket_fd = -1;
+        }
+        freeaddrinfo(info);
+    } else {
+        sockaddr_un unix_address{};
+        if (!MakeUnixAddress(address, unix_address)) {
+            std::cout << "Rollout >> invalid address [" << address << "]"
+                      << std::endl;
+            return -1;
+        }
+        socket_fd = MakeSocket(AF_UNIX, SOCK_STREAM);
+        // Remove stale sockets left behind by previous runs
+        if (socket_fd >= 0) {
+            unlink(address.c_str());
+        }
+        if (socket_fd >= 0 &&
+            bind(socket_fd,
+                 reinterpret_cast<sockaddr*>(&unix_address),  // NOLINT
+                 sizeof(unix_address)) != 0) {
+            close(socket_fd);
+            socket_fd = -1;
+        }
+    }
+
+    if (socket_fd < 0 || listen(socket_fd, backlog) != 0) {
+        std::cout << "Rollout >> couldn't listen on [" << address << "]"
+                  << std::endl;
+        if (socket_fd >= 0) {
+            close(socket_fd);
+        }
+        return -1;
+    }
+    // Accepting is driven by poll, so it should never block
+    fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL) | O_NONBLOCK);
+    return socket_fd;
+}
+
+auto RolloutAccept(int listen_fd) -> int {
+#if defined(__linux__)
+    const int socket_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+#else
+    const int socket_fd = accept(listen_fd, nullptr, nullptr);
+    if (socket_fd >= 0) {
+        fcntl(socket_fd, F_SETFD, FD_CLOEXEC);  // NOLINT
+    }
+#endif
+    if (socket_fd < 0) {
+        return -1;
+    }
+    // Some platforms inherit O_NONBLOCK from the listening socket
+    fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL) & ~O_NONBLOCK);
+    DisableSigPipe(socket_fd);
+    sockaddr_storage address{};
+    socklen_t address_size = sizeof(address);
+    if (getsockname(socket_fd,
+                    reinterpret_cast<sockaddr*>(&address),  // NOLINT
+                    &address_size) == 0 &&
+        address.ss_family != AF_UNIX) {
+        const int no_delay = 1;
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &no_delay,
+                   sizeof(no_delay));
+    }
+    return socket_fd;
+}
+
+auto RolloutSetTimeout(int socket_fd, double seconds) -> void {
+    constexpr double MICROSECONDS = 1e6;
+    timeval timeout{};
+    timeout.tv_sec = static_cast<time_t>(seconds);
+    timeout.tv_usec = static_cast<suseconds_t>(
+        (seconds - static_cast<double>(timeout.tv_sec)) * MICROSECONDS);
+    setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(socket_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+auto RolloutConnect(const std::string& address) -> int {
+    int socket_fd = -1;
+    if (IsTcpAddress(address)) {
+        auto* info = ResolveTcpAddress(address, false);
+        if (info == nullptr) {
+            return -1;
+        }
+        socket_fd = MakeSocket(info->ai_family, info->ai_socktype);
+        if (socket_fd >= 0 &&
+            connect(socket_fd, info->ai_addr, info->ai_addrlen) != 0) {
+            close(socket_fd);
+            socket_fd = -1;
+        }
+        freeaddrinfo(info);
+        if (socket_fd >= 0) {
+            // Messages are small and latency-sensitive
+            const int no_delay = 1;
+            setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &no_delay,
+                       sizeof(no_delay));
+        }
+    } else {
+        sockaddr_un unix_address{};
+        if (!MakeUnixAddress(address, unix_address)) {
+            return -1;
+        }
+        socket_fd = MakeSocket(AF_UNIX, SOCK_STREAM);
+        if (socket_fd >= 0 &&
+            connect(socket_fd,
+                    reinterpret_cast<sockaddr*>(&unix_address),  // NOLINT
+                    sizeof(unix_address)) != 0) {
+            close(socket_fd);
+            socket_fd = -1;
+        }
+    }
+    if (socket_fd >= 0) {
+        DisableSigPipe(socket_fd);
+    }
+    return socket_fd;
+}
+
+auto RolloutClose(int socket_fd, const std::string& address) -> void {
+    if (socket_fd >= 0) {
+        close(socket_fd);
+    }
+    if (!address.empty() && !IsTcpAddress(address)) {
+        unlink(address.c_str());
+    }
+}
+
+auto RolloutSend(int socket_fd, RolloutMessageType type, const void* payload,
+                 size_t payload_size) -> bool {
+    if (payload_size > ROLLOUT_MAX_PAYLOAD) {
+        return false;
+    }
+    RolloutMessageHeader header;
+    header.type = static_cast<uint32_t>(type);
+    header.payload_size = static_cast<uint32_t>(payload_size);
+    // Send header and payload with a single call for small messages
+    std::vector<uint8_t> buffer(sizeof(header) + payload_size);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    if (payload_size > 0) {
+        std::memcpy(buffer.data() + sizeof(header), payload, payload_size);
+    }
+    return WriteAll(socket_fd, buffer.data(), buffer.size());
+}
+
+auto RolloutReceive(int socket_fd, RolloutMessage& message) -> bool {
+    RolloutMessageHeader header;
+    if (!ReadAll(socket_fd, reinterpret_cast<uint8_t*>(&header),  // NOLINT
+                 sizeof(header))) {
+        return false;
+    }
+    if (header.magic != ROLLOUT_MAGIC ||
+        header.payload_size > ROLLOUT_MAX_PAYLOAD) {
+        return false;
+    }
+    message.type = static_cast<RolloutMessageType>(header.type);
+    message.payload.resize(header.payload_size);
+    return header.payload_size == 0 ||
+           ReadAll(socket_fd, message.payload.data(), header.payload_size);
+}
+
+auto RolloutReceiveAvailable(int socket_fd, std::vector<uint8_t>& buffer)
+    -> bool {
+    for (size_t received = 0; received < MAX_RECEIVE_SIZE;) {
+        const auto size = buffer.size();
+        buffer.resize(size + RECEIVE_BLOCK_SIZE);
+        const auto num_bytes = recv(socket_fd, buffer.data() + size,  // NOLINT
+                                    RECEIVE_BLOCK_SIZE, MSG_DONTWAIT);
+        buffer.resize(size +
+                      (num_bytes > 0 ? static_cast<size_t>(num_bytes) : 0));
+        if (num_bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (num_bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+        if (num_bytes <= 0) {
+            return false;
+        }
+        received += static_cast<size_t>(num_bytes);
+    }
+    return true;
+}
+
+auto RolloutParseMessage(const std::vector<uint8_t>& buffer, size_t& offset,
+                         RolloutMessage& message) -> RolloutParseResult {
+    RolloutMessageHeader header;
+    if (buffer.size() - offset < sizeof(header)) {
+        return RolloutParseResult::INCOMPLETE;
+    }
+    std::memcpy(&header, buffer.data() + offset, sizeof(header));  // NOLINT
+    if (header.magic != ROLLOUT_MAGIC ||
+        header.payload_size > ROLLOUT_MAX_PAYLOAD) {
+        return RolloutParseResult::INVALID;
+    }
+    const auto begin = offset + sizeof(header);
+    if (buffer.size() - begin < header.payload_size) {
+        return RolloutParseResult::INCOMPLETE;
+    }
+    message.type = static_cast<RolloutMessageType>(header.type);
+    message.payload.assign(buffer.begin() + begin,
+                           buffer.begin() + begin + header.payload_size);
+    offset = begin + header.payload_size;
+    return RolloutParseResult::MESSAGE;
+}
@@ -0,0 +1,266 @@
+#include <core/determinism_checker.hpp>
+#include <core/rollout_worker.hpp>
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+/// Size of the error buffer used when compiling a model
+constexpr size_t ERROR_BUFFER_SIZE = 1024;
+/// Time between attempts to connect to the coordinator
+constexpr auto CONNECT_RETRY_INTERVAL = std::chrono::milliseconds(50);
+
+/// Highest file descriptor closed by children when the limit is unknown
+constexpr long MAX_INHERITED_FD = 1L << 16L;
+
+/// Returns the number of threads of this process (0 if unknown)
+auto CountThreads() -> size_t {
+    size_t num_threads = 0;
+#if defined(__linux__)
+    std::error_code error_code;
+    for (const auto& entry :
+         std::filesystem::directory_iterator("/proc/self/task", error_code)) {
+        (void)entry;
+        ++num_threads;
+    }
+#endif
+    return num_threads;
+}
+
+/// Closes every file descriptor inherited from the parent (e.g. the listening
+/// socket of the coordinator) except for the standard streams. Only uses
+/// async-signal-safe calls, as it runs right after fork
+auto CloseInheritedFds() -> void {
+#if defined(__linux__) && defined(SYS_close_range)
+    if (syscall(SYS_close_range, 3U, ~0U, 0U) == 0) {
+        return;
+    }
+#endif
+    const long max_fd = sysconf(_SC_OPEN_MAX);
+    const long end = max_fd > 0 ? std::min(max_fd, MAX_INHERITED_FD)
+                                : MAX_INHERITED_FD;
+    for (long fd = STDERR_FILENO + 1; fd < end; ++fd) {
+        close(static_cast<int>(fd));
+    }
+}
+
+/// Advances the given state and returns a well-mixed 64-bit value
+auto SplitMix64(uint64_t& state) -> uint64_t {
+    state += 0x9e3779b97f4a7c15ULL;
+    uint64_t value = state;
+    value = (value ^ (value >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27U)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31U);
+}
+
+/// Adds uniform noise to the hinge|slide joints, seeded by the environment
+auto JitterJoints(const mjModel& model, mjData& data, uint32_t seed,
+                  uint32_t env_index, double scale) -> void {
+    uint64_t state = (static_cast<uint64_t>(seed) << 32U) | env_index;
+    for (int j = 0; j < model.njnt; ++j) {
+        const int type = model.jnt_type[j];  // NOLINT
+        if (type != mjJNT_HINGE && type != mjJNT_SLIDE) {
+            continue;
+        }
+        // Uniform sample in [-1, 1) from the top 53 bits
+        constexpr double INV_2_POW_53 = 1.0 / 9007199254740992.0;
+        const double unit =
+            static_cast<double>(SplitMix64(state) >> 11U) * INV_2_POW_53;
+        const int qpos_adr = model.jnt_qposadr[j];         // NOLINT
+        data.qpos[qpos_adr] += scale * (2.0 * unit - 1.0);  // NOLINT
+    }
+}
+
+/// Default serialization of the results: the hash of each final state
+auto WriteStateHashes(const mjModel& model, mjData* const* data_batch,
+                      const RolloutChunk& chunk, std::vector<uint8_t>& result)
+    -> void {
+    const auto offset = result.size();
+    result.resize(offset + chunk.num_envs * sizeof(StateHash));
+    for (uint32_t i = 0; i < chunk.num_envs; ++i) {
+        const auto& data = *data_batch[i];  // NOLINT
+        const auto hash = DeterminismChecker::Hash(model, data);
+        std::memcpy(result.data() + offset + i * sizeof(StateHash), &hash,
+                    sizeof(StateHash));
+    }
+}
+
+}  // namespace
+
+RolloutWorker::RolloutWorker(const mjModel& model,
+                             RolloutWorkerSettings settings)
+    : m_Model(&model), m_Settings(settings) {
+    _Init();
+}
+
+RolloutWorker::RolloutWorker(const std::string& model_path,
+                             RolloutWorkerSettings settings)
+    : m_Settings(settings) {
+    std::array<char, ERROR_BUFFER_SIZE> error_buffer{};
+    m_OwnedModel = std::unique_ptr<mjModel, MjcModelDeleter>(
+        mj_loadXML(model_path.c_str(), nullptr, error_buffer.data(),
+                   static_cast<int>(error_buffer.size())));
+    if (!m_OwnedModel) {
+        mju_error("RolloutWorker >> couldn't load model [%s]: %s",
+                  model_path.c_str(), error_buffer.data());
+    }
+    m_Model = m_OwnedModel.get();
+    _Init();
+}
+
+RolloutWorker::~RolloutWorker() {
+    // Join the threads before releasing the simulations they step
+    m_Pool = nullptr;
+}
+
+auto RolloutWorker::_Init() -> void {
+    m_ResetCache = std::make_unique<ResetCache>(*m_Model);
+    if (m_Settings.num_threads > 1) {
+        m_Pool = std::make_unique<ThreadPool>(
+            static_cast<size_t>(m_Settings.num_threads));
+    }
+    m_ResultFn = WriteStateHashes;
+}
+
+auto RolloutWorker::Run(const std::string& address) -> int {
+    int socket_fd = -1;
+    for (int i = 0; i < m_Settings.connect_attempts && socket_fd < 0; ++i) {
+        socket_fd = RolloutConnect(address);
+        if (socket_fd < 0) {
+            std::this_thread::sleep_for(CONNECT_RETRY_INTERVAL);
+        }
+    }
+    if (socket_fd < 0) {
+        std::cout << "RolloutWorker >> couldn't connect to [" << address << "]"
+                  << std::endl;
+        return -1;
+    }
+
+    const auto pid = static_cast<int64_t>(getpid());
+    if (!RolloutSend(socket_fd, RolloutMessageType::HELLO, &pid, sizeof(pid))) {
+        RolloutClose(socket_fd);
+        return -1;
+    }
+
+    int num_chunks = 0;
+    RolloutMessage message;
+    std::vector<uint8_t> result;
+    while (RolloutSend(socket_fd, RolloutMessageType::REQUEST, nullptr, 0) &&
+           RolloutReceive(socket_fd, message)) {
+        if (message.type != RolloutMessageType::CHUNK ||
+            message.payload.size() != sizeof(RolloutChunk)) {
+            break;
+        }
+        RolloutChunk chunk;
+        std::memcpy(&chunk, message.payload.data(), sizeof(RolloutChunk));
+
+        result.resize(sizeof(chunk.id));
+        std::memcpy(result.data(), &chunk.id, sizeof(chunk.id));
+        _RunChunk(chunk, result);
+        if (!RolloutSend(socket_fd, RolloutMessageType::RESULT, result.data(),
+                         result.size())) {
+            break;
+        }
+        ++num_chunks;
+    }
+    RolloutClose(socket_fd);
+    return num_chunks;
+}
+
+auto RolloutWorker::_RunChunk(const RolloutChunk& chunk,
+                              std::vector<uint8_t>& result) -> void {
+    const auto num_envs = static_cast<int>(chunk.num_envs);
+    while (static_cast<int>(m_Data.size()) < num_envs) {
+        m_Data.emplace_back(mj_makeData(m_Model));
+        m_DataPtrs.push_back(m_Data.back().get());
+    }
+
+    if (m_Settings.jitter_scale > 0.0) {
+        const auto scale = m_Settings.jitter_scale;
+        m_ResetCache->SetJitterFn([chunk, scale](const mjModel& model,
+                                                 mjData& data, int index) {
+            JitterJoints(model, data, chunk.seed,
+                         chunk.env_begin + static_cast<uint32_t>(index),
+                         scale);
+        });
+    }
+    m_ResetCache->RestoreBatch(m_DataPtrs.data(), num_envs, nullptr,
+                               m_Pool.get());
+
+    const auto step_env = [&](int i) {
+        for (int s = 0; s < m_Settings.num_substeps; ++s) {
+            mj_step(m_Model, m_DataPtrs[i]);
+        }
+    };
+    for (uint32_t step = 0; step < chunk.num_steps; ++step) {
+        if (m_Controller) {
+            m_Controller->ComputeBatch(*m_Model, m_DataPtrs.data(), num_envs);
+        }
+        if (m_Pool) {
+            m_Pool->ParallelFor(num_envs, step_env);
+        } else {
+            for (int i = 0; i < num_envs; ++i) {
+                step_env(i);
+            }
+        }
+    }
+
+    if (m_ResultFn) {
+        m_ResultFn(*m_Model, m_DataPtrs.data(), chunk, result);
+    }
+}
+
+auto RolloutWorker::SpawnLocal(
+    int num_workers, const mjModel& model, const std::string& address,
+    RolloutWorkerSettings settings,
+    const std::function<void(RolloutWorker&)>& setup_fn)
+    -> std::vector<pid_t> {
+    std::vector<pid_t> pids;
+    // Only the forking thread survives in the children, so locks held by the
+    // others (e.g. inside a thread pool) would stay locked there forever
+    const auto num_threads = CountThreads();
+    if (num_threads > 1) {
+        std::cout << "RolloutWorker >> forking a process with " << num_threads
+                  << " threads, spawn the workers before starting any thread"
+                  << std::endl;
+    }
+    // Flush before forking, so buffered output isn't duplicated by children
+    std::cout.flush();
+    for (int i = 0; i < num_workers; ++i) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            std::cout << "RolloutWorker >> couldn't fork worker " << i
+                      << std::endl;
+            break;
+        }
+        if (pid == 0) {
+            // Child: the compiled model is shared copy-on-write with the parent
+            CloseInheritedFds();
+            int exit_code = 0;
+            {
+                RolloutWorker worker(model, settings);
+                if (setup_fn) {
+                    setup_fn(worker);
+                }
+                exit_code = worker.Run(address) < 0 ? 1 : 0;
+            }
+            std::cout.flush();
+            _exit(exit_code);
+        }
+        pids.push_back(pid);
+    }
+    return pids;
+}
@@ -0,0 +1,207 @@
+#include <core/scene_visibility.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+#include <imgui.h>
+#endif
+
+// Orthographic cameras (and explicit frustum widths) appeared in MuJoCo 3
+#if defined(mjVERSION_HEADER) && mjVERSION_HEADER >= 300
+#define MUJOCOEXT_HAS_ORTHOGRAPHIC_CAMERAS
+#endif
+
+namespace {
+
+/// Number of geoms drawn for each object frame (one arrow per axis)
+constexpr int GEOMS_PER_FRAME = 3;
+/// Prime used to spread the decor geoms kept by the decimation
+constexpr uint32_t DECIMATION_PRIME = 7919;
+
+/// Returns the dot product of two 3d vectors
+auto Dot(const float* a, const float* b) -> float {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];  // NOLINT
+}
+
+}  // namespace
+
+auto SceneVisibility::ComputeCapacity(const mjModel& model, int budget)
+    -> int {
+    // Model geoms, plus the decor each kind of object can produce (a marker
+    // for sites|joints|actuators|cameras|lights, com and inertia boxes for
+    // bodies, a frame for the bodies, and a few segments per tendon)
+    const int num_decor = model.nsite + model.njnt + model.nu + model.ncam +
+                          model.nlight + 2 * model.nbody +
+                          GEOMS_PER_FRAME * model.nbody + model.nwrap +
+                          model.ntendon;
+    return model.ngeom + num_decor + std::max(budget, 0);
+}
+
+auto SceneVisibility::Capture(const mjvScene& scene) -> void {
+    m_NumProduced = scene.ngeom;
+    m_Geoms.assign(scene.geoms, scene.geoms + scene.ngeom);  // NOLINT
+    m_Captured = true;
+}
+
+auto SceneVisibility::Cull(mjvScene& scene, const mjrRect& viewport) -> int {
+    const mjvGeom* source = m_Captured ? m_Geoms.data() : scene.geoms;
+    const int num_source =
+        m_Captured ? static_cast<int>(m_Geoms.size()) : scene.ngeom;
+    if (!m_Captured) {
+        m_NumProduced = scene.ngeom;
+    }
+
+    const bool filtering =
+        m_Settings.frustum_culling || m_Settings.decor_distance > 0.0F;
+    if (!filtering) {
+        if (m_Captured) {
+            std::copy(source, source + num_source, scene.geoms);  // NOLINT
+            scene.ngeom = num_source;
+        }
+        m_NumVisible = scene.ngeom;
+        return m_NumVisible;
+    }
+
+    // Both eyes see (almost) the same, so cull against their average
+    const auto camera = mjv_averageCamera(&scene.camera[0], &scene.camera[1]);
+    const float aspect =
+        viewport.height > 0 ? static_cast<float>(viewport.width) /
+                                  static_cast<float>(viewport.height)
+                            : 1.0F;
+    int num_visible = 0;
+    for (int i = 0; i < num_source; ++i) {
+        if (_IsVisible(source[i], camera, aspect)) {  // NOLINT
+            // In place, the kept geoms only ever move towards the front
+            scene.geoms[num_visible++] = source[i];  // NOLINT
+        }
+    }
+    scene.ngeom = num_visible;
+    m_NumVisible = num_visible;
+    return num_visible;
+}
+
+auto SceneVisibility::_IsVisible(const mjvGeom& geom, const mjvGLCamera& camera,
+                                 float aspect) const -> bool {
+    // Planes are infinite (for rendering purposes), so always keep them
+    if (geom.type == mjGEOM_PLANE) {
+        return true;
+    }
+
+    const float delta[3] = {geom.pos[0] - camera.pos[0],   // NOLINT
+                            geom.pos[1] - camera.pos[1],   // NOLINT
+                            geom.pos[2] - camera.pos[2]};  // NOLINT
+    const float* fwd = camera.forward;
+    const float* up = camera.up;
+    const float right[3] = {fwd[1] * up[2] - fwd[2] * up[1],   // NOLINT
+                            fwd[2] * up[0] - fwd[0] * up[2],   // NOLINT
+                            fwd[0] * up[1] - fwd[1] * up[0]};  // NOLINT
+
+    if (m_Settings.decor_distance > 0.0F && geom.category == mjCAT_DECOR) {
+        const float distance = std::sqrt(Dot(delta, delta));
+        const auto stride =
+            1U + static_cast<uint32_t>(distance / m_Settings.decor_distance);
+        const auto key =
+            static_cast<uint32_t>(geom.objtype) * DECIMATION_PRIME +
+            static_cast<uint32_t>(geom.objid);
+        if (stride > 1 && key % stride != 0) {
+            return false;
+        }
+    }
+    if (!m_Settings.frustum_culling) {
+        return true;
+    }
+
+    // Conservative bounding sphere (the sum of the half-sizes covers boxes,
+    // capsules and arrows; model geoms also have their bounding radius)
+    const float radius =
+        std::max(geom.modelrbound, geom.size[0] + geom.size[1] + geom.size[2]) +
+        m_Settings.cull_margin;
+    const float x = Dot(delta, right);
+    const float y = Dot(delta, up);
+    const float z = Dot(delta, fwd);
+    if (z < camera.frustum_near - radius || z > camera.frustum_far + radius) {
+        return false;
+    }
+
+    float half_width =
+        0.5F * aspect * (camera.frustum_top - camera.frustum_bottom);
+    const float near_plane = camera.frustum_near;
+    const float top = camera.frustum_top;
+    const float bottom = camera.frustum_bottom;
+#ifdef MUJOCOEXT_HAS_ORTHOGRAPHIC_CAMERAS
+    if (camera.frustum_width > 0.0F) {
+        half_width = camera.frustum_width;
+    }
+#endif
+    const float left = camera.frustum_center - half_width;
+    const float rightmost = camera.frustum_center + half_width;
+
+#ifdef MUJOCOEXT_HAS_ORTHOGRAPHIC_CAMERAS
+    if (camera.orthographic != 0) {
+        return y <= top + radius && y >= bottom - radius &&
+               x <= rightmost + radius && x >= left - radius;
+    }
+#endif
+
+    // Side planes go through the eye and the borders of the near plane. A
+    // sphere is outside if it's further than its radius from any of them
+    const auto outside = [radius, near_plane](float coord, float border,
+                                              float depth, float sign) {
+        const float distance = sign * (coord * near_plane - border * depth);
+        return distance >
+               radius * std::sqrt(near_plane * near_plane + border * border);
+    };
+    return !outside(y, top, z, 1.0F) && !outside(y, bottom, z, -1.0F) &&
+           !outside(x, rightmost, z, 1.0F) && !outside(x, left, z, -1.0F);
+}
+
+auto SceneVisibility::RenderUi(mjvOption& option) -> void {
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+    auto& mask = m_Settings.category_mask;
+    bool show_static = (mask & mjCAT_STATIC) != 0;
+    bool show_dynamic = (mask & mjCAT_DYNAMIC) != 0;
+    bool show_decor = (mask & mjCAT_DECOR) != 0;
+    ImGui::Checkbox("Static", &show_static);
+    ImGui::SameLine();
+    ImGui::Checkbox("Dynamic", &show_dynamic);
+    ImGui::SameLine();
+    ImGui::Checkbox("Decor", &show_decor);
+    mask = (show_static ? mjCAT_STATIC : 0) |
+           (show_dynamic ? mjCAT_DYNAMIC : 0) | (show_decor ? mjCAT_DECOR : 0);
+
+    ImGui::Text("Geom groups");
+    for (int g = 0; g < mjNGROUP; ++g) {
+        ImGui::PushID(g);
+        bool enabled = option.geomgroup[g] != 0;  // NOLINT
+        ImGui::SameLine();
+        if (ImGui::Checkbox("##geomgroup", &enabled)) {
+            option.geomgroup[g] = enabled ? 1 : 0;  // NOLINT
+        }
+        ImGui::PopID();
+    }
+    ImGui::Text("Site groups");
+    for (int g = 0; g < mjNGROUP; ++g) {
+        ImGui::PushID(mjNGROUP + g);
+        bool enabled = option.sitegroup[g] != 0;  // NOLINT
+        ImGui::SameLine();
+        if (ImGui::Checkbox("##sitegroup", &enabled)) {
+            option.sitegroup[g] = enabled ? 1 : 0;  // NOLINT
+        }
+        ImGui::PopID();
+    }
+
+    constexpr float MAX_DECOR_DISTANCE = 50.0F;
+    constexpr float MAX_CULL_MARGIN = 5.0F;
+    ImGui::Checkbox("Frustum culling", &m_Settings.frustum_culling);
+    ImGui::SliderFloat("Cull margin", &m_Settings.cull_margin, 0.0F,
+                       MAX_CULL_MARGIN);
+    ImGui::SliderFloat("Decor distance", &m_Settings.decor_distance, 0.0F,
+                       MAX_DECOR_DISTANCE);
+    ImGui::Text("Geoms: %d produced, %d rendered", m_NumProduced,
+                m_NumVisible);
+#else
+    (void)option;
+#endif
+}
@@ -0,0 +1,394 @@
+#include <core/telemetry.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+#include <imgui.h>
+#endif
+
+// MuJoCo 3 replaced solver_iter with the iterations of each island
+#if defined(mjVERSION_HEADER) && mjVERSION_HEADER >= 300
+#define MUJOCOEXT_HAS_SOLVER_ISLANDS
+#endif
+
+namespace {
+
+/// Returns the name of the given object, or a default one if it has none
+auto GetObjectName(const mjModel& model, mjtObj type, int id,
+                   const char* prefix) -> std::string {
+    const char* name = mj_id2name(&model, type, id);
+    if (name != nullptr && name[0] != '\0') {
+        return name;
+    }
+    return std::string(prefix) + std::to_string(id);
+}
+
+/// Returns "[i]" for multi-dimensional quantities (empty for scalars)
+auto IndexSuffix(int dim, int i) -> std::string {
+    return dim == 1 ? "" : "[" + std::to_string(i) + "]";
+}
+
+/// Returns the number of solver iterations of the last step (summed over all
+/// constraint islands)
+auto GetSolverIterations(const mjData& data) -> int {
+#ifdef MUJOCOEXT_HAS_SOLVER_ISLANDS
+    int num_iterations = 0;
+    const int num_islands = std::min(data.solver_nisland, mjNISLAND);
+    for (int i = 0; i < num_islands; ++i) {
+        num_iterations += data.solver_niter[i];  // NOLINT
+    }
+    return num_iterations;
+#else
+    return data.solver_iter;
+#endif
+}
+
+/// Rounds the given number up to the next power of two
+auto NextPowerOfTwo(size_t value) -> size_t {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1U;
+    }
+    return result;
+}
+
+/// Returns where the given level (>= 1) of a pyramid starts
+auto LevelOffset(size_t capacity, size_t level) -> size_t {
+    return capacity - (capacity >> (level - 1));
+}
+
+/// Returns the size of the buffer the given source reads from (-1 for scalar
+/// sources, which don't use an index)
+auto GetSourceSize(const mjModel& model, TelemetrySource source) -> int {
+    switch (source) {
+        case TelemetrySource::SENSOR:
+            return model.nsensordata;
+        case TelemetrySource::QPOS:
+            return model.nq;
+        case TelemetrySource::QVEL:
+            return model.nv;
+        case TelemetrySource::CTRL:
+            return model.nu;
+        case TelemetrySource::ACT:
+            return model.na;
+        default:
+            return -1;
+    }
+}
+
+}  // namespace
+
+Telemetry::Telemetry(size_t capacity)
+    : m_Capacity(NextPowerOfTwo(std::max<size_t>(capacity, 2))) {
+    m_Times.resize(m_Capacity, 0.0);
+    while ((size_t{1} << m_NumLevels) < m_Capacity) {
+        ++m_NumLevels;
+    }
+    m_PlotWindow = static_cast<int>(
+        std::min<size_t>(m_Capacity, std::numeric_limits<int>::max()));
+}
+
+auto Telemetry::AddSensor(const mjModel& model, int sensor_id) -> void {
+    if (sensor_id < 0 || sensor_id >= model.nsensor) {
+        return;
+    }
+    const auto name = GetObjectName(model, mjOBJ_SENSOR, sensor_id, "sensor_");
+    const int adr = model.sensor_adr[sensor_id];  // NOLINT
+    const int dim = model.sensor_dim[sensor_id];  // NOLINT
+    for (int i = 0; i < dim; ++i) {
+        AddChannel(model, {name + IndexSuffix(dim, i), TelemetrySource::SENSOR,
+                           adr + i});
+    }
+}
+
+auto Telemetry::AddJoint(const mjModel& model, int joint_id) -> void {
+    if (joint_id < 0 || joint_id >= model.njnt) {
+        return;
+    }
+    const auto name = GetObjectName(model, mjOBJ_JOINT, joint_id, "joint_");
+    const int joint_type = model.jnt_type[joint_id];  // NOLINT
+    int num_qpos = 1;
+    int num_qvel = 1;
+    if (joint_type == mjJNT_FREE) {
+        num_qpos = 7;  // NOLINT
+        num_qvel = 6;  // NOLINT
+    } else if (joint_type == mjJNT_BALL) {
+        num_qpos = 4;
+        num_qvel = 3;
+    }
+    const int qpos_adr = model.jnt_qposadr[joint_id];  // NOLINT
+    const int qvel_adr = model.jnt_dofadr[joint_id];   // NOLINT
+    for (int i = 0; i < num_qpos; ++i) {
+        AddChannel(model, {name + ".qpos" + IndexSuffix(num_qpos, i),
+                           TelemetrySource::QPOS, qpos_adr + i});
+    }
+    for (int i = 0; i < num_qvel; ++i) {
+        AddChannel(model, {name + ".qvel" + IndexSuffix(num_qvel, i),
+                           TelemetrySource::QVEL, qvel_adr + i});
+    }
+}
+
+auto Telemetry::AddSolverStats() -> void {
+    _PushChannel({"solver.iterations", TelemetrySource::SOLVER_ITER, 0});
+    _PushChannel({"solver.ncon", TelemetrySource::NUM_CONTACTS, 0});
+    _PushChannel({"solver.nefc", TelemetrySource::NUM_CONSTRAINTS, 0});
+    _PushChannel({"energy.potential", TelemetrySource::ENERGY_POTENTIAL, 0});
+    _PushChannel({"energy.kinetic", TelemetrySource::ENERGY_KINETIC, 0});
+}
+
+auto Telemetry::AddChannel(const mjModel& model, TelemetryChannel channel)
+    -> bool {
+    const int size = GetSourceSize(model, channel.source);
+    if (size >= 0 && (channel.index < 0 || channel.index >= size)) {
+        std::cout << "Telemetry >> index " << channel.index
+                  << " of channel [" << channel.name
+                  << "] is out of range (buffer of size " << size << ")"
+                  << std::endl;
+        return false;
+    }
+    _PushChannel(std::move(channel));
+    return true;
+}
+
+auto Telemetry::_PushChannel(TelemetryChannel channel) -> void {
+    m_Channels.push_back(std::move(channel));
+    // Older samples of the new channel (if any) are read as zeros
+    m_Values.resize(m_Channels.size() * m_Capacity, 0.0F);
+    m_PyramidMin.resize(m_Channels.size() * m_Capacity, 0.0F);
+    m_PyramidMax.resize(m_Channels.size() * m_Capacity, 0.0F);
+}
+
+auto Telemetry::ClearChannels() -> void {
+    m_Channels.clear();
+    m_Values.clear();
+    m_PyramidMin.clear();
+    m_PyramidMax.clear();
+    Clear();
+}
+
+auto Telemetry::Clear() -> void {
+    m_Head = 0;
+    m_NumSamples = 0;
+}
+
+auto Telemetry::Record(const mjData& data) -> void {
+    if (!m_Enabled || m_Channels.empty()) {
+        return;
+    }
+
+    float* slot = m_Values.data() + m_Head;  // NOLINT
+    for (size_t c = 0; c < m_Channels.size(); ++c) {
+        const auto& channel = m_Channels[c];
+        mjtNum value = 0.0;
+        switch (channel.source) {
+            case TelemetrySource::SENSOR:
+                value = data.sensordata[channel.index];  // NOLINT
+                break;
+            case TelemetrySource::QPOS:
+                value = data.qpos[channel.index];  // NOLINT
+                break;
+            case TelemetrySource::QVEL:
+                value = data.qvel[channel.index];  // NOLINT
+                break;
+            case TelemetrySource::CTRL:
+                value = data.ctrl[channel.index];  // NOLINT
+                break;
+            case TelemetrySource::ACT:
+                value = data.act[channel.index];  // NOLINT
+                break;
+            case TelemetrySource::SOLVER_ITER:
+                value = static_cast<mjtNum>(GetSolverIterations(data));
+                break;
+            case TelemetrySource::NUM_CONTACTS:
+                value = static_cast<mjtNum>(data.ncon);
+                break;
+            case TelemetrySource::NUM_CONSTRAINTS:
+                value = static_cast<mjtNum>(data.nefc);
+                break;
+            case TelemetrySource::ENERGY_POTENTIAL:
+                value = data.energy[0];  // NOLINT
+                break;
+            case TelemetrySource::ENERGY_KINETIC:
+                value = data.energy[1];  // NOLINT
+                break;
+        }
+        *slot = static_cast<float>(value);
+        slot += m_Capacity;  // NOLINT
+        _UpdatePyramid(c, m_Head);
+    }
+    m_Times[m_Head] = data.time;
+
+    m_Head = (m_Head + 1) & (m_Capacity - 1);
+    m_NumSamples = std::min(m_NumSamples + 1, m_Capacity);
+}
+
+auto Telemetry::GetSample(size_t channel, size_t i) const -> float {
+    const auto idx = (m_Head + m_Capacity - 1 - i) & (m_Capacity - 1);
+    return m_Values[channel * m_Capacity + idx];
+}
+
+auto Telemetry::GetDecimated(size_t channel, size_t num_samples, int num_bins,
+                             std::vector<float>& envelope) const -> int {
+    if (channel >= m_Channels.size() || num_bins <= 0) {
+        return 0;
+    }
+    const auto count = std::min(num_samples, m_NumSamples);
+    const auto mask = m_Capacity - 1;
+    const auto start = (m_Head + m_Capacity - count) & mask;
+    const float* values = m_Values.data() + channel * m_Capacity;  // NOLINT
+
+    const auto bins = static_cast<size_t>(num_bins);
+    if (count <= 2 * bins) {
+        envelope.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            envelope[i] = values[(start + i) & mask];  // NOLINT
+        }
+        return static_cast<int>(count);
+    }
+
+    // Keep the extremes of each bin so that the plot shows the same peaks as
+    // the full-resolution signal would. The pyramid doesn't know which one
+    // came first, so a bin that starts closer to its max draws the max first
+    envelope.resize(2 * bins);
+    for (size_t b = 0; b < bins; ++b) {
+        const auto bin_begin = (start + (b * count) / bins) & mask;
+        const auto bin_size = ((b + 1) * count) / bins - (b * count) / bins;
+        float min_value = FLT_MAX;
+        float max_value = -FLT_MAX;
+        const auto first_end = std::min(bin_begin + bin_size, m_Capacity);
+        _GetRange(channel, bin_begin, first_end, min_value, max_value);
+        _GetRange(channel, 0, bin_size - (first_end - bin_begin), min_value,
+                  max_value);
+
+        const float first = values[bin_begin];  // NOLINT
+        const bool max_first = (max_value - first) < (first - min_value);
+        envelope[2 * b + 0] = max_first ? max_value : min_value;
+        envelope[2 * b + 1] = max_first ? min_value : max_value;
+    }
+    return static_cast<int>(2 * bins);
+}
+
+auto Telemetry::_UpdatePyramid(size_t channel, size_t slot) -> void {
+    const float* values = m_Values.data() + channel * m_Capacity;  // NOLINT
+    float* min_values = m_PyramidMin.data() + channel * m_Capacity;  // NOLINT
+    float* max_values = m_PyramidMax.data() + channel * m_Capacity;  // NOLINT
+
+    // Walk up from the slot, combining each block from its two halves
+    size_t index = slot;
+    for (size_t level = 1; level <= m_NumLevels; ++level) {
+        const size_t left = index & ~size_t{1};
+        float lo = 0.0F;
+        float hi = 0.0F;
+        if (level == 1) {
+            lo = std::min(values[left], values[left + 1]);  // NOLINT
+            hi = std::max(values[left], values[left + 1]);  // NOLINT
+        } else {
+            const auto below = LevelOffset(m_Capacity, level - 1) + left;
+            lo = std::min(min_values[below], min_values[below + 1]);  // NOLINT
+            hi = std::max(max_values[below], max_values[below + 1]);  // NOLINT
+        }
+        index >>= 1U;
+        const auto offset = LevelOffset(m_Capacity, level) + index;
+        min_values[offset] = lo;  // NOLINT
+        max_values[offset] = hi;  // NOLINT
+    }
+}
+
+auto Telemetry::_GetRange(size_t channel, size_t begin, size_t end,
+                          float& min_value, float& max_value) const -> void {
+    const float* values = m_Values.data() + channel * m_Capacity;  // NOLINT
+    const float* min_values =
+        m_PyramidMin.data() + channel * m_Capacity;  // NOLINT
+    const float* max_values =
+        m_PyramidMax.data() + channel * m_Capacity;  // NOLINT
+
+    // Covers the range with the largest aligned blocks that fit in it
+    while (begin < end) {
+        size_t level = 0;
+        while (level < m_NumLevels) {
+            const size_t next_size = size_t{2} << level;
+            if ((begin & (next_size - 1)) != 0 || begin + next_size > end) {
+                break;
+            }
+            ++level;
+        }
+        if (level == 0) {
+            min_value = std::min(min_value, values[begin]);  // NOLINT
+            max_value = std::max(max_value, values[begin]);  // NOLINT
+        } else {
+            const auto offset =
+                LevelOffset(m_Capacity, level) + (begin >> level);
+            min_value = std::min(min_value, min_values[offset]);  // NOLINT
+            max_value = std::max(max_value, max_values[offset]);  // NOLINT
+        }
+        begin += size_t{1} << level;
+    }
+}
+
+auto Telemetry::Export(const std::string& filepath) const -> bool {
+    std::ofstream file(filepath);
+    if (!file.is_open()) {
+        std::cout << "Telemetry >> couldn't open file [" << filepath
+                  << "] for writing" << std::endl;
+        return false;
+    }
+
+    constexpr int PRECISION = 9;
+    file.precision(PRECISION);
+    file << "time";
+    for (const auto& channel : m_Channels) {
+        file << "," << channel.name;
+    }
+    file << "\n";
+
+    const auto start = (m_Head + m_Capacity - m_NumSamples) & (m_Capacity - 1);
+    for (size_t i = 0; i < m_NumSamples; ++i) {
+        const auto idx = (start + i) & (m_Capacity - 1);
+        file << m_Times[idx];
+        for (size_t c = 0; c < m_Channels.size(); ++c) {
+            file << "," << m_Values[c * m_Capacity + idx];
+        }
+        file << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+auto Telemetry::RenderUi() -> void {
+#ifndef MUJOCOEXT_BUILD_HEADLESS
+    ImGui::Checkbox("Recording", &m_Enabled);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        Clear();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export")) {
+        Export(m_ExportPath);
+    }
+    ImGui::SameLine();
+    ImGui::TextUnformatted(m_ExportPath.c_str());
+    ImGui::Text("Samples: %zu / %zu", m_NumSamples, m_Capacity);
+    ImGui::SliderInt("Window", &m_PlotWindow, 2,
+                     static_cast<int>(std::min<size_t>(
+                         m_Capacity, std::numeric_limits<int>::max())));
+
+    constexpr float PLOT_HEIGHT = 60.0F;
+    constexpr size_t OVERLAY_SIZE = 32;
+    char overlay[OVERLAY_SIZE];  // NOLINT
+    for (size_t c = 0; c < m_Channels.size(); ++c) {
+        const int count =
+            GetDecimated(c, static_cast<size_t>(m_PlotWindow),
+                         TELEMETRY_PLOT_BINS, m_PlotBuffer);
+        const float latest = m_NumSamples > 0 ? GetSample(c, 0) : 0.0F;
+        std::snprintf(overlay, OVERLAY_SIZE, "%.4f", latest);  // NOLINT
+        ImGui::PlotLines(m_Channels[c].name.c_str(), m_PlotBuffer.data(),
+                         count, 0, overlay, FLT_MAX, FLT_MAX,
+                         ImVec2(0.0F, PLOT_HEIGHT));
+    }
+#endif
+}
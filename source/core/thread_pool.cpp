@@ -0,0 +1,96 @@
+#include <core/thread_pool.hpp>
+
+#include <algorithm>
+#include <utility>
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    m_Workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        m_Workers.emplace_back([this]() { _WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    WaitIdle();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_CondTasks.notify_all();
+    for (auto& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+auto ThreadPool::Enqueue(std::function<void()> task) -> void {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Tasks.push_back(std::move(task));
+    }
+    m_CondTasks.notify_one();
+}
+
+auto ThreadPool::WaitIdle() -> void {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_CondIdle.wait(lock,
+                    [this]() { return m_Tasks.empty() && m_NumBusy == 0; });
+}
+
+auto ThreadPool::ParallelFor(int count, const std::function<void(int)>& func)
+    -> void {
+    if (count <= 0) {
+        return;
+    }
+    const int num_chunks = std::min(count, static_cast<int>(m_Workers.size()));
+    const int chunk_size = (count + num_chunks - 1) / num_chunks;
+
+    std::mutex mutex;
+    std::condition_variable cond_done;
+    int num_pending = num_chunks;
+    for (int c = 0; c < num_chunks; ++c) {
+        const int start = c * chunk_size;
+        const int end = std::min(count, start + chunk_size);
+        Enqueue([&, start, end]() {
+            for (int i = start; i < end; ++i) {
+                func(i);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--num_pending == 0) {
+                cond_done.notify_one();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cond_done.wait(lock, [&]() { return num_pending == 0; });
+}
+
+auto ThreadPool::_WorkerLoop() -> void {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_CondTasks.wait(lock,
+                             [this]() { return m_Stop || !m_Tasks.empty(); });
+            if (m_Stop && m_Tasks.empty()) {
+                return;
+            }
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+            ++m_NumBusy;
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            --m_NumBusy;
+            if (m_Tasks.empty() && m_NumBusy == 0) {
+                m_CondIdle.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,167 @@
+#include <core/viewer_control.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define MUJOCOEXT_HAS_UNIX_SOCKETS
+#endif
+
+namespace {
+
+/// Latest request received through a signal (0: none, 1: attach, 2: detach)
+volatile std::sig_atomic_t s_signal_request = 0;  // NOLINT
+
+/// Maximum number of connections accepted per call to Poll
+constexpr int MAX_CONNECTIONS_PER_POLL = 4;
+/// Maximum number of clients waiting to complete their command
+constexpr size_t MAX_PENDING_CLIENTS = 16;
+/// Maximum size of a command sent through the socket
+constexpr size_t MAX_COMMAND_SIZE = 32;
+/// Time a client has to send its command before being dropped
+constexpr auto CLIENT_TIMEOUT = std::chrono::seconds(1);
+
+/// Translates a command sent through the socket
+auto ParseCommand(const char* command) -> ViewerCommand {
+    if (std::strncmp(command, "attach", std::strlen("attach")) == 0) {
+        return ViewerCommand::ATTACH;
+    }
+    if (std::strncmp(command, "detach", std::strlen("detach")) == 0) {
+        return ViewerCommand::DETACH;
+    }
+    return ViewerCommand::NONE;
+}
+
+}  // namespace
+
+ViewerControl::~ViewerControl() {
+#ifdef MUJOCOEXT_HAS_UNIX_SOCKETS
+    for (const auto& client : m_Clients) {
+        close(client.fd);
+    }
+    if (m_SocketFd >= 0) {
+        close(m_SocketFd);
+        unlink(m_SocketPath.c_str());
+    }
+#endif
+}
+
+auto ViewerControl::InstallSignalHandlers() -> bool {
+#ifdef MUJOCOEXT_HAS_UNIX_SOCKETS
+    std::signal(SIGUSR1, [](int) { s_signal_request = 1; });
+    std::signal(SIGUSR2, [](int) { s_signal_request = 2; });
+    return true;
+#else
+    return false;
+#endif
+}
+
+auto ViewerControl::Listen(const std::string& socket_path) -> bool {
+#ifdef MUJOCOEXT_HAS_UNIX_SOCKETS
+    sockaddr_un address{};
+    if (m_SocketFd >= 0 || socket_path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    const int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd < 0) {
+        std::cout << "ViewerControl >> couldn't create socket" << std::endl;
+        return false;
+    }
+
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(),  // NOLINT
+                 sizeof(address.sun_path) - 1);
+    // Remove stale sockets left behind by previous runs
+    unlink(socket_path.c_str());
+    if (bind(socket_fd, reinterpret_cast<sockaddr*>(&address),  // NOLINT
+             sizeof(address)) != 0 ||
+        listen(socket_fd, MAX_CONNECTIONS_PER_POLL) != 0) {
+        std::cout << "ViewerControl >> couldn't listen on socket ["
+                  << socket_path << "]" << std::endl;
+        close(socket_fd);
+        return false;
+    }
+    const int flags = fcntl(socket_fd, F_GETFL);  // NOLINT
+    fcntl(socket_fd, F_SETFL, flags | O_NONBLOCK);  // NOLINT
+
+    m_SocketFd = socket_fd;
+    m_SocketPath = socket_path;
+    return true;
+#else
+    return false;
+#endif
+}
+
+auto ViewerControl::Poll() -> ViewerCommand {
+    auto command = ViewerCommand::NONE;
+    if (s_signal_request != 0) {
+        command = (s_signal_request == 1) ? ViewerCommand::ATTACH
+                                          : ViewerCommand::DETACH;
+        s_signal_request = 0;
+    }
+
+#ifdef MUJOCOEXT_HAS_UNIX_SOCKETS
+    if (m_SocketFd < 0) {
+        return command;
+    }
+    for (int i = 0; i < MAX_CONNECTIONS_PER_POLL &&
+                    m_Clients.size() < MAX_PENDING_CLIENTS;
+         ++i) {
+        const int client_fd = accept(m_SocketFd, nullptr, nullptr);
+        if (client_fd < 0) {
+            break;  // no pending connections (the socket is non-blocking)
+        }
+        // Some platforms don't make the accepted socket inherit the flag
+        const int flags = fcntl(client_fd, F_GETFL);    // NOLINT
+        fcntl(client_fd, F_SETFL, flags | O_NONBLOCK);  // NOLINT
+        m_Clients.push_back(
+            {client_fd, "", std::chrono::steady_clock::now() + CLIENT_TIMEOUT});
+    }
+
+    // Slow clients keep their partial command until the next call
+    m_Clients.erase(std::remove_if(m_Clients.begin(), m_Clients.end(),
+                                   [this, &command](Client& client) {
+                                       if (!_ReadClient(client, command)) {
+                                           return false;
+                                       }
+                                       close(client.fd);
+                                       return true;
+                                   }),
+                    m_Clients.end());
+#endif
+    return command;
+}
+
+auto ViewerControl::_ReadClient(Client& client, ViewerCommand& command)
+    -> bool {
+#ifdef MUJOCOEXT_HAS_UNIX_SOCKETS
+    char buffer[MAX_COMMAND_SIZE] = {};  // NOLINT
+    const auto capacity = MAX_COMMAND_SIZE - client.buffer.size();
+    const auto num_bytes = recv(client.fd, buffer, capacity, 0);
+    if (num_bytes > 0) {
+        client.buffer.append(buffer, static_cast<size_t>(num_bytes));
+    }
+
+    const auto received = ParseCommand(client.buffer.c_str());
+    if (received != ViewerCommand::NONE) {
+        command = received;
+        return true;
+    }
+    const bool would_block =
+        num_bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    const bool waiting = num_bytes > 0 || would_block;
+    return !waiting || client.buffer.size() >= MAX_COMMAND_SIZE ||
+           std::chrono::steady_clock::now() > client.deadline;
+#else
+    (void)client;
+    (void)command;
+    return true;
+#endif
+}